@@ -0,0 +1,306 @@
+#pragma once
+
+#include "Set.h"
+#include "SetTraits.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+// Ordered set for read-mostly workloads with skewed lookups: elements are kept in the Set, and lookups go to the
+// snapshot of it, which is laid out as a weight-balanced search tree by access counters sampled in contains(), so
+// frequently accessed values sit near the root and are found in O(log(W / w)) comparisons, where w is the weight
+// of the value and W is the total weight. Writes update the snapshot in place: inserted values are attached as
+// leaves unless that makes the snapshot deeper than O(log W), then they are looked up in the Set, and erased
+// values are marked, so the layout survives the writes. The snapshot is rebuilt by relayout(), which runs
+// automatically on a write once enough lookups were sampled or enough values were left out of the snapshot since
+// the previous one. contains() only updates relaxed atomic counters, so it may be called concurrently like the
+// const methods of Set
+template<typename ValueType>
+class AccessWeightedSet {
+  private:
+    using Index = uint32_t;
+
+    static constexpr Index NIL = UINT32_MAX;
+
+    // Vertex of the snapshot, vertexes are stored in preorder, so the hot paths from the root are close in memory,
+    // vertexes of the values inserted after the relayout are appended
+    struct Entry {
+        ValueType value;
+        Index left_son;
+        Index right_son;
+        bool is_erased;
+    };
+
+  public:
+    using iterator = typename Set<ValueType>::iterator;
+
+    // Creates empty set that counts every sample_period-th lookup of every thread and relayouts the snapshot on the
+    // first write after max(relayout_period, n) lookups
+    explicit AccessWeightedSet(size_t sample_period = DEFAULT_SAMPLE_PERIOD,
+                               size_t relayout_period = DEFAULT_RELAYOUT_PERIOD)
+        : sample_period_(std::max<size_t>(sample_period, 1))
+        , relayout_period_(std::max<size_t>(relayout_period, 1))
+    {}
+
+    // Creates copy of the given set with its layout and access counters, complexity O(n)
+    AccessWeightedSet(const AccessWeightedSet& s)
+        : sample_period_(s.sample_period_)
+        , relayout_period_(s.relayout_period_)
+        , tree_(s.tree_)
+        , entries_(s.entries_)
+        , depth_limit_(s.depth_limit_)
+        , detached_values_(s.detached_values_)
+        , sampled_lookups_(s.sampled_lookups_.load(std::memory_order_relaxed))
+    {
+        for (const std::atomic<uint64_t>& counter: s.counters_) {
+            counters_.emplace_back(counter.load(std::memory_order_relaxed));
+        }
+    }
+
+    // Replaces the set by copy of the given set, complexity O(n + m)
+    AccessWeightedSet& operator=(const AccessWeightedSet& s) {
+        if (this != &s) {
+            sample_period_ = s.sample_period_;
+            relayout_period_ = s.relayout_period_;
+            tree_ = s.tree_;
+            entries_ = s.entries_;
+            counters_.clear();
+            for (const std::atomic<uint64_t>& counter: s.counters_) {
+                counters_.emplace_back(counter.load(std::memory_order_relaxed));
+            }
+            depth_limit_ = s.depth_limit_;
+            detached_values_ = s.detached_values_;
+            sampled_lookups_.store(s.sampled_lookups_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        return *this;
+    }
+
+    // If given value isn't in the set - inserts it, returns true if value was inserted, the value is attached to the
+    // snapshot as a leaf, complexity O(log n + log W), plus amortized O(log n) for the relayouts, which take
+    // O(n log n) once per max(relayout_period, n) lookups or n / 2 values left out of the snapshot
+    bool insert(const ValueType& value) {
+        RelayoutIfDue();
+        size_t old_size = tree_.size();
+        tree_.insert(value);
+        if (tree_.size() == old_size) {
+            return false;
+        }
+        if (!AttachEntry(value)) {
+            ++detached_values_;
+        }
+        return true;
+    }
+
+    // If given value is in the set - erase it, returns amount of erased elements, the value is marked erased in the
+    // snapshot, complexity O(log n + log W), plus amortized O(log n) for the relayouts
+    size_t erase(const ValueType& value) {
+        RelayoutIfDue();
+        size_t erased = tree_.erase(value);
+        if (erased != 0) {
+            Index position = Find(value);
+            if (position != NIL) {
+                entries_[position].is_erased = true;
+            } else {
+                --detached_values_;
+            }
+        }
+        return erased;
+    }
+
+    // Returns true if given value is in the set, samples the access, complexity O(log(W / w)) for the values placed
+    // by the last relayout, O(log W) for the ones attached after it, O(log W + log n) for the ones left out
+    bool contains(const ValueType& value) const {
+        Index position = Find(value);
+        if (position == NIL) {
+            return detached_values_ != 0 && tree_.find(value) != tree_.end();
+        }
+        if (entries_[position].is_erased) {
+            return false;
+        }
+        size_t& countdown = SampleCountdown();
+        if (countdown == 0 || --countdown == 0) {
+            countdown = sample_period_;
+            counters_[position].fetch_add(1, std::memory_order_relaxed);
+            sampled_lookups_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Rebuilds the snapshot from the elements of the set weighted by their access counters, counters are halved, so
+    // the layout follows changes of the workload, complexity O(n log n)
+    void relayout() {
+        std::vector<ValueType> values;
+        std::vector<uint64_t> weights;
+        values.reserve(tree_.size());
+        weights.reserve(tree_.size());
+        std::vector<std::pair<ValueType, uint64_t>> counted = CountedValues();
+        size_t counted_position = 0;
+        for (const ValueType& value: tree_) {
+            while (counted_position < counted.size() && counted[counted_position].first < value) {
+                ++counted_position;
+            }
+            uint64_t counter = 0;
+            if (counted_position < counted.size() && !(value < counted[counted_position].first)) {
+                counter = counted[counted_position].second / 2;
+            }
+            values.push_back(value);
+            weights.push_back(counter);
+        }
+
+        std::vector<uint64_t> prefix_weights(values.size() + 1, 0);
+        for (size_t i = 0; i < values.size(); ++i) {
+            prefix_weights[i + 1] = prefix_weights[i] + weights[i] + 1;
+        }
+        entries_.clear();
+        counters_.clear();
+        entries_.reserve(values.size());
+        Build(values, weights, prefix_weights, 0, values.size());
+        depth_limit_ = 2;
+        for (uint64_t total_weight = prefix_weights.back(); total_weight != 0; total_weight >>= 1) {
+            depth_limit_ += 2;
+        }
+        detached_values_ = 0;
+        sampled_lookups_.store(0, std::memory_order_relaxed);
+    }
+
+    // Returns iterator of the first element of the set, or end() if set is empty(), complexity O(log n)
+    iterator begin() const {
+        return tree_.begin();
+    }
+
+    // Returns iterator of the end of the set, complexity O(1)
+    iterator end() const {
+        return tree_.end();
+    }
+
+    // Returns amount of elements the set contains, complexity O(1)
+    size_t size() const {
+        return tree_.size();
+    }
+
+    // Returns true if set is empty, or false if it isn't, complexity O(1)
+    bool empty() const {
+        return tree_.empty();
+    }
+
+    static constexpr size_t DEFAULT_SAMPLE_PERIOD = 1;
+    static constexpr size_t DEFAULT_RELAYOUT_PERIOD = 1 << 16;
+
+  private:
+    // Relayouts the snapshot if enough lookups were sampled or enough values were left out of it since the previous
+    // relayout, complexity O(1) if not
+    void RelayoutIfDue() {
+        size_t lookups = sampled_lookups_.load(std::memory_order_relaxed) * sample_period_;
+        if (lookups >= std::max(relayout_period_, tree_.size()) || detached_values_ * 2 > tree_.size()) {
+            relayout();
+        }
+    }
+
+    // Attaches entry of the value inserted after the relayout as a leaf of the snapshot, or clears the mark of its
+    // erased entry, returns false if the leaf would be deeper than the limit, complexity O(log W)
+    bool AttachEntry(const ValueType& value) {
+        Index parent = NIL;
+        bool is_left_son = false;
+        size_t depth = 0;
+        Index position = entries_.empty() ? NIL : 0;
+        while (position != NIL) {
+            Entry& entry = entries_[position];
+            int order = ThreeWayCompare(value, entry.value);
+            if (order == 0) {
+                entry.is_erased = false;
+                return true;
+            }
+            parent = position;
+            is_left_son = order < 0;
+            position = is_left_son ? entry.left_son : entry.right_son;
+            ++depth;
+        }
+        if (depth >= depth_limit_) {
+            return false;
+        }
+        Index attached = static_cast<Index>(entries_.size());
+        if (parent != NIL) {
+            (is_left_son ? entries_[parent].left_son : entries_[parent].right_son) = attached;
+        }
+        entries_.push_back(Entry{value, NIL, NIL, false});
+        counters_.emplace_back(0);
+        return true;
+    }
+
+    // Returns countdown of the lookups of the calling thread to the next sampled one, complexity O(1)
+    static size_t& SampleCountdown() {
+        static thread_local size_t countdown = 0;
+        return countdown;
+    }
+
+    // Returns position of the entry with the given value, or NIL if the snapshot doesn't contain it,
+    // complexity O(log(W / w))
+    Index Find(const ValueType& value) const {
+        Index position = entries_.empty() ? NIL : 0;
+        while (position != NIL) {
+            const Entry& entry = entries_[position];
+            int order = ThreeWayCompare(value, entry.value);
+            if (order == 0) {
+                return position;
+            }
+            position = order < 0 ? entry.left_son : entry.right_son;
+        }
+        return NIL;
+    }
+
+    // Returns values of the snapshot with their access counters in order of values, complexity O(n)
+    std::vector<std::pair<ValueType, uint64_t>> CountedValues() const {
+        std::vector<std::pair<ValueType, uint64_t>> counted;
+        counted.reserve(entries_.size());
+        std::vector<Index> path;
+        Index position = entries_.empty() ? NIL : 0;
+        while (position != NIL || !path.empty()) {
+            while (position != NIL) {
+                path.push_back(position);
+                position = entries_[position].left_son;
+            }
+            position = path.back();
+            path.pop_back();
+            if (!entries_[position].is_erased) {
+                counted.emplace_back(entries_[position].value, counters_[position].load(std::memory_order_relaxed));
+            }
+            position = entries_[position].right_son;
+        }
+        return counted;
+    }
+
+    // Appends the weight-balanced tree of the given sorted range in preorder: the root is the value at which the
+    // prefix weight crosses the middle of the range weight, so every subtree has at most half of the weight of
+    // its grandparent, returns position of the root, complexity O(k log k)
+    Index Build(const std::vector<ValueType>& values, const std::vector<uint64_t>& weights,
+                const std::vector<uint64_t>& prefix_weights, size_t begin, size_t end) {
+        if (begin == end) {
+            return NIL;
+        }
+        uint64_t middle_weight = prefix_weights[begin] + (prefix_weights[end] - prefix_weights[begin]) / 2;
+        size_t root = std::upper_bound(prefix_weights.begin() + begin + 1, prefix_weights.begin() + end,
+                                       middle_weight) - prefix_weights.begin() - 1;
+        Index position = static_cast<Index>(entries_.size());
+        entries_.push_back(Entry{values[root], NIL, NIL, false});
+        counters_.emplace_back(weights[root]);
+        Index left_son = Build(values, weights, prefix_weights, begin, root);
+        Index right_son = Build(values, weights, prefix_weights, root + 1, end);
+        entries_[position].left_son = left_son;
+        entries_[position].right_son = right_son;
+        return position;
+    }
+
+    size_t sample_period_;
+    size_t relayout_period_;
+    Set<ValueType> tree_;
+    std::vector<Entry> entries_;
+    mutable std::deque<std::atomic<uint64_t>> counters_;
+    size_t depth_limit_ = 2;
+    size_t detached_values_ = 0;
+    mutable std::atomic<size_t> sampled_lookups_{0};
+};
@@ -0,0 +1,505 @@
+#pragma once
+
+#include "SetTraits.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Balancing policies of Set. Every vertex stores a rank in its level field, missing vertexes have rank 0, and the
+// policy keeps the tree balanced by rules on the rank differences between parents and sons. Insert and Erase walk
+// the tree recursively and call AfterInsert or AfterErase on every vertex of the path bottom-up, after one of its
+// subtrees has changed, and the policy returns the new root of the subtree of the vertex. Vertexes are erased only
+// as leaves, values move between vertexes while ranks stay. Join links two trees and a vertex with a value between
+// them into one tree, it's the base of the parallel set operations. Policies with random ranks set
+// HAS_RANDOM_RANKS, then trees of sorted vertexes are built by drawing fresh ranks instead of BalancedRank
+
+// Returns rank of the vertex, or 0 if it's missing, complexity O(1)
+template<typename Node>
+AA_SET_CONSTEXPR size_t RankOf(const Node* vertex) {
+    return vertex == nullptr ? 0 : vertex->level;
+}
+
+// Rotates the left son of the given vertex up and returns it, complexity O(1)
+template<typename Node>
+AA_SET_CONSTEXPR Node* RotateRight(Node* vertex) {
+    Node* s = vertex->left_son;
+    vertex->left_son = s->right_son;
+    if (s->right_son != nullptr) {
+        s->right_son->SetParent(vertex);
+    }
+    s->right_son = vertex;
+    s->SetParent(vertex->Parent());
+    vertex->SetParent(s);
+    return s;
+}
+
+// Rotates the right son of the given vertex up and returns it, complexity O(1)
+template<typename Node>
+AA_SET_CONSTEXPR Node* RotateLeft(Node* vertex) {
+    Node* s = vertex->right_son;
+    vertex->right_son = s->left_son;
+    if (s->left_son != nullptr) {
+        s->left_son->SetParent(vertex);
+    }
+    s->left_son = vertex;
+    s->SetParent(vertex->Parent());
+    vertex->SetParent(s);
+    return s;
+}
+
+// Links the given vertex with the given sons and rank, complexity O(1)
+template<typename Node>
+AA_SET_CONSTEXPR Node* LinkVertex(Node* left, Node* middle, Node* right, size_t rank) {
+    middle->left_son = left;
+    middle->right_son = right;
+    if (left != nullptr) {
+        left->SetParent(middle);
+    }
+    if (right != nullptr) {
+        right->SetParent(middle);
+    }
+    middle->level = rank;
+    return middle;
+}
+
+// Join of the policies with rank differences of at most 2: descends along the right spine of the left tree, which
+// must have the greater or equal rank, to the first vertex with rank not greater than the rank of the right tree,
+// replaces it with the middle vertex of the next rank over both, and rebalances the path as after an insert,
+// complexity O(rank(left) - rank(right) + 1)
+template<typename Balance, typename Node>
+AA_SET_CONSTEXPR Node* JoinRight(Node* left, Node* middle, Node* right) {
+    if (RankOf(left) <= RankOf(right)) {
+        return LinkVertex(left, middle, right, RankOf(right) + 1);
+    }
+    left->right_son = JoinRight<Balance>(left->right_son, middle, right);
+    left->right_son->SetParent(left);
+    return Balance::AfterInsert(left);
+}
+
+// Mirrored JoinRight for the right tree with the greater rank, complexity O(rank(right) - rank(left) + 1)
+template<typename Balance, typename Node>
+AA_SET_CONSTEXPR Node* JoinLeft(Node* left, Node* middle, Node* right) {
+    if (RankOf(right) <= RankOf(left)) {
+        return LinkVertex(left, middle, right, RankOf(left) + 1);
+    }
+    right->left_son = JoinLeft<Balance>(left, middle, right->left_son);
+    right->left_son->SetParent(right);
+    return Balance::AfterInsert(right);
+}
+
+template<typename Balance, typename Node>
+AA_SET_CONSTEXPR Node* JoinByRank(Node* left, Node* middle, Node* right) {
+    if (RankOf(left) >= RankOf(right)) {
+        return JoinRight<Balance>(left, middle, right);
+    }
+    return JoinLeft<Balance>(left, middle, right);
+}
+
+// AA-tree: rank is the level, only right sons may have the level of their parent and never two in a row,
+// complexity of the steps O(1)
+struct AaBalance {
+    static constexpr bool HAS_RANDOM_RANKS = false;
+
+    static AA_SET_CONSTEXPR size_t LeafRank() {
+        return 1;
+    }
+
+    // Rank of the vertex of the perfectly balanced tree with sons of the given ranks, where the left subtree is not
+    // greater than the right one, so only right sons can be horizontal
+    static AA_SET_CONSTEXPR size_t BalancedRank(size_t left_rank, size_t right_rank) {
+        return std::min(left_rank, right_rank) + 1;
+    }
+
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* AfterInsert(Node* vertex) {
+        return Split(Skew(vertex));
+    }
+
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* Join(Node* left, Node* middle, Node* right) {
+        return JoinByRank<AaBalance>(left, middle, right);
+    }
+
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* AfterErase(Node* vertex) {
+        DecreaseLevel(vertex);
+        vertex = Skew(vertex);
+        if (vertex->right_son != nullptr) {
+            vertex->right_son = Skew(vertex->right_son);
+            if (vertex->right_son->right_son != nullptr) {
+                vertex->right_son->right_son = Skew(vertex->right_son->right_son);
+            }
+        }
+        vertex = Split(vertex);
+        if (vertex->right_son != nullptr) {
+            vertex->right_son = Split(vertex->right_son);
+        }
+        return vertex;
+    }
+
+    // Rotates the given vertex to balance level, according to the left son, complexity O(1)
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* Skew(Node* vertex) {
+        if (vertex->left_son == nullptr || vertex->left_son->level != vertex->level) {
+            return vertex;
+        }
+        return RotateRight(vertex);
+    }
+
+    // Rotates the given vertex to balance level, according to the right son, complexity O(1)
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* Split(Node* vertex) {
+        if (vertex->right_son == nullptr || vertex->right_son->right_son == nullptr ||
+            vertex->level != vertex->right_son->right_son->level) {
+            return vertex;
+        }
+        Node* s = RotateLeft(vertex);
+        ++s->level;
+        return s;
+    }
+
+    // Balances level of given vertex, complexity O(1)
+    template<typename Node>
+    static AA_SET_CONSTEXPR void DecreaseLevel(Node* vertex) {
+        size_t expected_level = std::min(RankOf(vertex->left_son), RankOf(vertex->right_son)) + 1;
+        if (vertex->level > expected_level) {
+            vertex->level = expected_level;
+            if (vertex->right_son != nullptr && vertex->right_son->level > expected_level) {
+                vertex->right_son->level = expected_level;
+            }
+        }
+    }
+};
+
+// Red-black tree: rank is the black height, red vertexes are the ones with the rank of their parent, rank
+// differences are 0 or 1 and no red vertex has a red son. Takes at most 2 rotations per insert and 3 per erase,
+// complexity of the steps O(1)
+struct RedBlackBalance {
+    static constexpr bool HAS_RANDOM_RANKS = false;
+
+    static AA_SET_CONSTEXPR size_t LeafRank() {
+        return 1;
+    }
+
+    static AA_SET_CONSTEXPR size_t BalancedRank(size_t left_rank, size_t right_rank) {
+        return std::min(left_rank, right_rank) + 1;
+    }
+
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* AfterInsert(Node* vertex) {
+        if (IsRedWithRedSon(vertex, vertex->left_son)) {
+            if (IsRed(vertex, vertex->right_son)) {
+                ++vertex->level;
+                return vertex;
+            }
+            if (!IsRed(vertex->left_son, vertex->left_son->left_son)) {
+                vertex->left_son = RotateLeft(vertex->left_son);
+            }
+            return RotateRight(vertex);
+        }
+        if (IsRedWithRedSon(vertex, vertex->right_son)) {
+            if (IsRed(vertex, vertex->left_son)) {
+                ++vertex->level;
+                return vertex;
+            }
+            if (!IsRed(vertex->right_son, vertex->right_son->right_son)) {
+                vertex->right_son = RotateRight(vertex->right_son);
+            }
+            return RotateLeft(vertex);
+        }
+        return vertex;
+    }
+
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* Join(Node* left, Node* middle, Node* right) {
+        return JoinByRank<RedBlackBalance>(left, middle, right);
+    }
+
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* AfterErase(Node* vertex) {
+        if (vertex->level - RankOf(vertex->left_son) == 2) {
+            return FixLeftDeficit(vertex);
+        }
+        if (vertex->level - RankOf(vertex->right_son) == 2) {
+            return FixRightDeficit(vertex);
+        }
+        return vertex;
+    }
+
+  private:
+    template<typename Node>
+    static AA_SET_CONSTEXPR bool IsRed(const Node* parent, const Node* son) {
+        return son != nullptr && son->level == parent->level;
+    }
+
+    template<typename Node>
+    static AA_SET_CONSTEXPR bool IsRedWithRedSon(const Node* parent, const Node* son) {
+        return IsRed(parent, son) && (IsRed(son, son->left_son) || IsRed(son, son->right_son));
+    }
+
+    // Restores the rules when the black height of the left subtree has decreased, complexity O(1)
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* FixLeftDeficit(Node* vertex) {
+        Node* sibling = vertex->right_son;
+        if (IsRed(vertex, sibling)) {
+            Node* root = RotateLeft(vertex);
+            root->left_son = FixLeftDeficit(vertex);
+            return root;
+        }
+        if (IsRed(sibling, sibling->right_son)) {
+            Node* root = RotateLeft(vertex);
+            ++root->level;
+            --vertex->level;
+            return root;
+        }
+        if (IsRed(sibling, sibling->left_son)) {
+            vertex->right_son = RotateRight(sibling);
+            Node* root = RotateLeft(vertex);
+            ++root->level;
+            --vertex->level;
+            return root;
+        }
+        --vertex->level;
+        return vertex;
+    }
+
+    // Restores the rules when the black height of the right subtree has decreased, complexity O(1)
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* FixRightDeficit(Node* vertex) {
+        Node* sibling = vertex->left_son;
+        if (IsRed(vertex, sibling)) {
+            Node* root = RotateRight(vertex);
+            root->right_son = FixRightDeficit(vertex);
+            return root;
+        }
+        if (IsRed(sibling, sibling->left_son)) {
+            Node* root = RotateRight(vertex);
+            ++root->level;
+            --vertex->level;
+            return root;
+        }
+        if (IsRed(sibling, sibling->right_son)) {
+            vertex->left_son = RotateLeft(sibling);
+            Node* root = RotateRight(vertex);
+            ++root->level;
+            --vertex->level;
+            return root;
+        }
+        --vertex->level;
+        return vertex;
+    }
+};
+
+// Weak AVL tree: rank differences are 1 or 2 and leaves have rank 1, so without erases the tree is an AVL tree,
+// and erases take at most 2 rotations. Sons of equal rank under a son of rank equal to the parent come only from
+// joins, complexity of the steps O(1)
+struct WavlBalance {
+    static constexpr bool HAS_RANDOM_RANKS = false;
+
+    static AA_SET_CONSTEXPR size_t LeafRank() {
+        return 1;
+    }
+
+    static AA_SET_CONSTEXPR size_t BalancedRank(size_t left_rank, size_t right_rank) {
+        return std::max(left_rank, right_rank) + 1;
+    }
+
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* AfterInsert(Node* vertex) {
+        if (RankOf(vertex->left_son) == vertex->level) {
+            Node* son = vertex->left_son;
+            if (vertex->level - RankOf(vertex->right_son) == 1) {
+                ++vertex->level;
+                return vertex;
+            }
+            if (son->level - RankOf(son->right_son) == 2) {
+                Node* root = RotateRight(vertex);
+                --vertex->level;
+                return root;
+            }
+            if (son->level - RankOf(son->left_son) == 1) {
+                Node* root = RotateRight(vertex);
+                ++root->level;
+                return root;
+            }
+            vertex->left_son = RotateLeft(son);
+            Node* root = RotateRight(vertex);
+            ++root->level;
+            --son->level;
+            --vertex->level;
+            return root;
+        }
+        if (RankOf(vertex->right_son) == vertex->level) {
+            Node* son = vertex->right_son;
+            if (vertex->level - RankOf(vertex->left_son) == 1) {
+                ++vertex->level;
+                return vertex;
+            }
+            if (son->level - RankOf(son->left_son) == 2) {
+                Node* root = RotateLeft(vertex);
+                --vertex->level;
+                return root;
+            }
+            if (son->level - RankOf(son->right_son) == 1) {
+                Node* root = RotateLeft(vertex);
+                ++root->level;
+                return root;
+            }
+            vertex->right_son = RotateRight(son);
+            Node* root = RotateLeft(vertex);
+            ++root->level;
+            --son->level;
+            --vertex->level;
+            return root;
+        }
+        return vertex;
+    }
+
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* Join(Node* left, Node* middle, Node* right) {
+        return JoinByRank<WavlBalance>(left, middle, right);
+    }
+
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* AfterErase(Node* vertex) {
+        if (vertex->left_son == nullptr && vertex->right_son == nullptr) {
+            vertex->level = LeafRank();
+            return vertex;
+        }
+        if (vertex->level - RankOf(vertex->left_son) == 3) {
+            return FixLeftDeficit(vertex);
+        }
+        if (vertex->level - RankOf(vertex->right_son) == 3) {
+            return FixRightDeficit(vertex);
+        }
+        return vertex;
+    }
+
+  private:
+    // Restores the rules when the left son became a 3-son, complexity O(1)
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* FixLeftDeficit(Node* vertex) {
+        Node* sibling = vertex->right_son;
+        if (vertex->level - sibling->level == 2 ||
+            (sibling->level - RankOf(sibling->left_son) == 2 && sibling->level - RankOf(sibling->right_son) == 2)) {
+            if (vertex->level - sibling->level == 1) {
+                --sibling->level;
+            }
+            --vertex->level;
+            return vertex;
+        }
+        if (sibling->level - RankOf(sibling->right_son) == 1) {
+            Node* root = RotateLeft(vertex);
+            ++root->level;
+            --vertex->level;
+            if (vertex->left_son == nullptr && vertex->right_son == nullptr) {
+                vertex->level = LeafRank();
+            }
+            return root;
+        }
+        vertex->right_son = RotateRight(sibling);
+        Node* root = RotateLeft(vertex);
+        root->level += 2;
+        --sibling->level;
+        vertex->level -= 2;
+        return root;
+    }
+
+    // Restores the rules when the right son became a 3-son, complexity O(1)
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* FixRightDeficit(Node* vertex) {
+        Node* sibling = vertex->left_son;
+        if (vertex->level - sibling->level == 2 ||
+            (sibling->level - RankOf(sibling->left_son) == 2 && sibling->level - RankOf(sibling->right_son) == 2)) {
+            if (vertex->level - sibling->level == 1) {
+                --sibling->level;
+            }
+            --vertex->level;
+            return vertex;
+        }
+        if (sibling->level - RankOf(sibling->left_son) == 1) {
+            Node* root = RotateRight(vertex);
+            ++root->level;
+            --vertex->level;
+            if (vertex->left_son == nullptr && vertex->right_son == nullptr) {
+                vertex->level = LeafRank();
+            }
+            return root;
+        }
+        vertex->left_son = RotateLeft(sibling);
+        Node* root = RotateRight(vertex);
+        root->level += 2;
+        --sibling->level;
+        vertex->level -= 2;
+        return root;
+    }
+};
+
+// Treap with geometrically distributed priorities, as in zip trees: rank is the priority, ties are broken by
+// values, so left sons have ranks less than their parents and right sons not greater, the expected depth of a
+// vertex is O(log n) and erases need no rotations. Trees of sorted vertexes are built as Cartesian trees over
+// fresh priorities, since any deterministic ranks would stack equal ranks of the built trees on the spines.
+// Priorities are drawn from the thread-local generator, which every thread seeds differently, complexity of the
+// steps O(1)
+struct TreapBalance {
+    static constexpr bool HAS_RANDOM_RANKS = true;
+
+    static size_t LeafRank() {
+        static std::atomic<uint64_t> seeds(0);
+        static thread_local uint64_t state = Mix(seeds.fetch_add(1, std::memory_order_relaxed));
+        state += 0x9e3779b97f4a7c15ULL;
+        uint64_t random = Mix(state);
+        size_t rank = 1;
+        while ((random & 1) != 0) {
+            ++rank;
+            random >>= 1;
+        }
+        return rank;
+    }
+
+    // Returns the SplitMix64 finalizer of the given state, complexity O(1)
+    static AA_SET_CONSTEXPR uint64_t Mix(uint64_t random) {
+        random = (random ^ (random >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        random = (random ^ (random >> 27)) * 0x94d049bb133111ebULL;
+        return random ^ (random >> 31);
+    }
+
+    static AA_SET_CONSTEXPR size_t BalancedRank(size_t left_rank, size_t right_rank) {
+        return std::max(left_rank, right_rank) + 1;
+    }
+
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* AfterInsert(Node* vertex) {
+        if (RankOf(vertex->left_son) >= vertex->level) {
+            return RotateRight(vertex);
+        }
+        if (RankOf(vertex->right_son) > vertex->level) {
+            return RotateLeft(vertex);
+        }
+        return vertex;
+    }
+
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* AfterErase(Node* vertex) {
+        return vertex;
+    }
+
+    // Join keeps the priority of the middle vertex and puts the vertex of the highest priority at the root,
+    // complexity O(log n) expected
+    template<typename Node>
+    static AA_SET_CONSTEXPR Node* Join(Node* left, Node* middle, Node* right) {
+        if (RankOf(left) < middle->level && RankOf(right) <= middle->level) {
+            return LinkVertex(left, middle, right, middle->level);
+        }
+        if (RankOf(left) >= RankOf(right)) {
+            left->right_son = Join(left->right_son, middle, right);
+            left->right_son->SetParent(left);
+            return left;
+        }
+        right->left_son = Join(left, middle, right->left_son);
+        right->left_son->SetParent(right);
+        return right;
+    }
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+
+#if __cplusplus >= 202002L && defined(__has_include)
+#if __has_include(<bit>)
+#include <bit>
+#define AA_SET_HAS_STD_BIT 1
+#endif
+#endif
+
+// Word-level bit helpers used by integer sets, compiled to tzcnt/lzcnt/popcnt where the target supports them
+
+// Returns number of zero bits below the lowest set bit, word must be non-zero, complexity O(1)
+inline int CountTrailingZeros(uint64_t word) {
+#if defined(AA_SET_HAS_STD_BIT)
+    return std::countr_zero(word);
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int ans = 0;
+    while ((word & 1) == 0) {
+        word >>= 1;
+        ++ans;
+    }
+    return ans;
+#endif
+}
+
+// Returns number of zero bits above the highest set bit, word must be non-zero, complexity O(1)
+inline int CountLeadingZeros(uint64_t word) {
+#if defined(AA_SET_HAS_STD_BIT)
+    return std::countl_zero(word);
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(word);
+#else
+    int ans = 0;
+    while ((word & (uint64_t(1) << 63)) == 0) {
+        word <<= 1;
+        ++ans;
+    }
+    return ans;
+#endif
+}
+
+// Returns index of the highest set bit, word must be non-zero, complexity O(1)
+inline int HighestBit(uint64_t word) {
+    return 63 - CountLeadingZeros(word);
+}
+
+// Returns amount of set bits, complexity O(1)
+inline int PopCount(uint64_t word) {
+#if defined(AA_SET_HAS_STD_BIT)
+    return std::popcount(word);
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    int ans = 0;
+    while (word != 0) {
+        word &= word - 1;
+        ++ans;
+    }
+    return ans;
+#endif
+}
+
+// Returns mask with all bits not less than the given position set, position must be less than 64, complexity O(1)
+inline uint64_t BitsFrom(int position) {
+    return ~uint64_t(0) << position;
+}
+
+// Returns mask with all bits not greater than the given position set, position must be less than 64, complexity O(1)
+inline uint64_t BitsUpTo(int position) {
+    return ~uint64_t(0) >> (63 - position);
+}
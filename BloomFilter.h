@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Finalizer of splitmix64, spreads bits of the standard hash that is often the identity for integers,
+// complexity O(1)
+inline uint64_t MixHash(uint64_t hash) {
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+// Tells if std::hash is enabled for the value type
+template<typename ValueType, typename = void>
+struct IsHashable : std::false_type {};
+
+template<typename ValueType>
+struct IsHashable<ValueType, decltype(void(std::hash<ValueType>()(std::declval<const ValueType&>())))>
+    : std::true_type {};
+
+// Hash of the filters that can be attached to containers of any value type: std::hash for hashable types, and
+// a stub for the others, containers must not enable their filters for them
+template<typename ValueType, bool Hashable = IsHashable<ValueType>::value>
+struct FilterHash : std::hash<ValueType> {};
+
+template<typename ValueType>
+struct FilterHash<ValueType, false> {
+    size_t operator()(const ValueType&) const {
+        return 0;
+    }
+};
+
+// Approximate membership filter: MayContain returns false only for values that were never added,
+// and true for other values with probability about 0.6185^(bits per element)
+template<typename ValueType, typename Hash = std::hash<ValueType>>
+class BloomFilter {
+  public:
+    explicit BloomFilter(size_t expected_elements = 0, size_t bits_per_element = DEFAULT_BITS_PER_ELEMENT)
+        : words_(std::max<size_t>((expected_elements * bits_per_element + WORD_BITS - 1) / WORD_BITS, 1), 0)
+        , hash_count_(std::max<size_t>(bits_per_element * 69 / 100, 1))
+    {}
+
+    // Adds value to the filter, complexity O(k)
+    void Add(const ValueType& value) {
+        uint64_t first_hash = 0;
+        uint64_t second_hash = 0;
+        Hashes(value, first_hash, second_hash);
+        for (size_t i = 0; i < hash_count_; ++i) {
+            uint64_t bit = (first_hash + i * second_hash) % (words_.size() * WORD_BITS);
+            words_[bit / WORD_BITS] |= uint64_t(1) << (bit % WORD_BITS);
+        }
+    }
+
+    // Returns false if value was never added, or true if it may have been added, complexity O(k)
+    bool MayContain(const ValueType& value) const {
+        uint64_t first_hash = 0;
+        uint64_t second_hash = 0;
+        Hashes(value, first_hash, second_hash);
+        for (size_t i = 0; i < hash_count_; ++i) {
+            uint64_t bit = (first_hash + i * second_hash) % (words_.size() * WORD_BITS);
+            if ((words_[bit / WORD_BITS] >> (bit % WORD_BITS) & 1) == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Forgets all added values, complexity O(m)
+    void Clear() {
+        std::fill(words_.begin(), words_.end(), 0);
+    }
+
+    static constexpr size_t DEFAULT_BITS_PER_ELEMENT = 10;
+
+  private:
+    static constexpr size_t WORD_BITS = 64;
+
+    // Computes two independent hashes of the value, i-th probe of double hashing is first + i * second,
+    // complexity O(1)
+    static void Hashes(const ValueType& value, uint64_t& first_hash, uint64_t& second_hash) {
+        first_hash = MixHash(static_cast<uint64_t>(Hash()(value)));
+        second_hash = MixHash(first_hash) | 1;
+    }
+
+    std::vector<uint64_t> words_;
+    size_t hash_count_;
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Set.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Ordered set that absorbs inserts in a small sorted buffer in front of the AA-tree and merges the buffer into the
+// tree in batches once it fills. Const methods merge the buffer first, so iterators are the ones of the underlying
+// Set. The merge is guarded by a mutex and is done by the first const call after inserts, so const methods may be
+// called concurrently like those of Set
+template<typename ValueType>
+class BufferedSet {
+  public:
+    using iterator = typename Set<ValueType>::iterator;
+
+    explicit BufferedSet(size_t buffer_capacity = DEFAULT_BUFFER_CAPACITY)
+        : buffer_capacity_(std::max<size_t>(buffer_capacity, 1))
+    {
+        buffer_.reserve(buffer_capacity_);
+    }
+
+    BufferedSet(const BufferedSet& s) : BufferedSet(s.buffer_capacity_) {
+        s.flush();
+        tree_ = s.tree_;
+    }
+
+    BufferedSet(BufferedSet&& s)
+        : buffer_capacity_(s.buffer_capacity_)
+        , buffer_(std::move(s.buffer_))
+        , tree_(std::move(s.tree_))
+        , has_buffered_(!buffer_.empty())
+    {}
+
+    BufferedSet& operator=(const BufferedSet& s) {
+        if (&s == this) {
+            return *this;
+        }
+        s.flush();
+        buffer_capacity_ = s.buffer_capacity_;
+        buffer_.clear();
+        tree_ = s.tree_;
+        has_buffered_.store(false, std::memory_order_relaxed);
+        return *this;
+    }
+
+    BufferedSet& operator=(BufferedSet&& s) {
+        std::swap(buffer_capacity_, s.buffer_capacity_);
+        std::swap(buffer_, s.buffer_);
+        tree_ = std::move(s.tree_);
+        has_buffered_.store(!buffer_.empty(), std::memory_order_relaxed);
+        s.has_buffered_.store(!s.buffer_.empty(), std::memory_order_relaxed);
+        return *this;
+    }
+
+    // If given value isn't in the set - puts it in the buffer and returns true, else returns false, merges the
+    // buffer into the tree when it's full, complexity O(log n + b), amortized O(log n) for the merge
+    bool insert(const ValueType& value) {
+        auto position = std::lower_bound(buffer_.begin(), buffer_.end(), value);
+        if ((position != buffer_.end() && !(value < *position)) || tree_.find(value) != tree_.end()) {
+            return false;
+        }
+        buffer_.insert(position, value);
+        has_buffered_.store(true, std::memory_order_relaxed);
+        if (buffer_.size() >= buffer_capacity_) {
+            flush();
+        }
+        return true;
+    }
+
+    // If given value is in the set - erase it, returns amount of erased elements, complexity O(log n + b)
+    size_t erase(const ValueType& value) {
+        auto position = std::lower_bound(buffer_.begin(), buffer_.end(), value);
+        if (position != buffer_.end() && !(value < *position)) {
+            buffer_.erase(position);
+            return 1;
+        }
+        return tree_.erase(value);
+    }
+
+    // If given value is in the set - returns iterator of the element with this value, else - returns end(),
+    // merges the buffer first, complexity O(log n) after the merge
+    iterator find(const ValueType& value) const {
+        flush();
+        return tree_.find(value);
+    }
+
+    // Returns iterator of the element with the smallest value not less, then given, or end() if this element
+    // doesn't exist, merges the buffer first, complexity O(log n) after the merge
+    iterator lower_bound(const ValueType& value) const {
+        flush();
+        return tree_.lower_bound(value);
+    }
+
+    // Returns iterator of the first element of the set, or end() if set is empty(), merges the buffer first,
+    // complexity O(log n) after the merge
+    iterator begin() const {
+        flush();
+        return tree_.begin();
+    }
+
+    // Returns iterator of the end of the set, complexity O(1)
+    iterator end() const {
+        return tree_.end();
+    }
+
+    // Returns amount of elements the set contains, merges the buffer first, complexity O(1) after the merge
+    size_t size() const {
+        flush();
+        return tree_.size();
+    }
+
+    // Returns true if set is empty, or false if it isn't, merges the buffer first, complexity O(1) after the merge
+    bool empty() const {
+        return size() == Set<ValueType>::EMPTY_SIZE;
+    }
+
+    // Merges buffered values into the tree, complexity O(1) if there are none, otherwise O(min(b log n, n + b))
+    void flush() const {
+        if (!has_buffered_.load(std::memory_order_acquire)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(flush_mutex_);
+        if (!has_buffered_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        tree_.insert_sorted(buffer_.begin(), buffer_.end());
+        buffer_.clear();
+        has_buffered_.store(false, std::memory_order_release);
+    }
+
+    static constexpr size_t DEFAULT_BUFFER_CAPACITY = 256;
+
+  private:
+    size_t buffer_capacity_;
+    mutable std::vector<ValueType> buffer_;
+    mutable Set<ValueType> tree_;
+    mutable std::atomic<bool> has_buffered_{false};
+    mutable std::mutex flush_mutex_;
+};
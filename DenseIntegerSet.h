@@ -0,0 +1,324 @@
+#pragma once
+
+#include "BitOperations.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Ordered set of integers from the bounded universe [lowest, highest] with the same interface as Set, implemented
+// with using hierarchical bitset: bit of the lowest level tells if the value is in the set, bit of every upper level
+// tells if the corresponding word of the level below isn't zero. Universe of the set is the whole range of the type
+// for types not wider than 16 bits, or the range given at construction
+template<typename ValueType>
+class DenseIntegerSet {
+    static_assert(std::is_integral<ValueType>::value, "DenseIntegerSet supports only integer values");
+
+  private:
+    static constexpr int WORD_BITS = 64;
+    static constexpr size_t BLOCK_BITS = WORD_BITS * WORD_BITS;
+    static constexpr size_t NPOS = std::numeric_limits<size_t>::max();
+    static constexpr bool HAS_DEFAULT_UNIVERSE = std::numeric_limits<ValueType>::digits <= 16;
+
+  public:
+    DenseIntegerSet()
+        : DenseIntegerSet(std::numeric_limits<ValueType>::min(), std::numeric_limits<ValueType>::max())
+    {
+        static_assert(HAS_DEFAULT_UNIVERSE, "Universe of the set must be given for types wider than 16 bits");
+    }
+
+    // Creates empty set with the universe [lowest, highest], memory O((highest - lowest) / 8) bytes. Throws
+    // std::invalid_argument if highest is less than lowest, and std::length_error if the size of the universe isn't
+    // representable in size_t
+    DenseIntegerSet(ValueType lowest, ValueType highest)
+        : lowest_(lowest)
+        , universe_size_(UniverseSize(lowest, highest))
+    {
+        size_t level_size = universe_size_;
+        do {
+            level_size = (level_size + WORD_BITS - 1) / WORD_BITS;
+            levels_.emplace_back(level_size, 0);
+        } while (level_size > 1);
+        block_counts_.assign((levels_.front().size() + WORD_BITS - 1) / WORD_BITS + 1, 0);
+    }
+
+    // Integer arguments are bounds of the universe, not iterators
+    template<typename FirstIterator, typename LastIterator,
+             typename = typename std::enable_if<!std::is_integral<FirstIterator>::value>::type>
+    DenseIntegerSet(FirstIterator begin, LastIterator end) : DenseIntegerSet() {
+        while (begin != end) {
+            insert(*begin);
+            ++begin;
+        }
+    }
+
+    DenseIntegerSet(std::initializer_list<ValueType> elements) : DenseIntegerSet() {
+        for (const auto& value: elements) {
+            insert(value);
+        }
+    }
+
+    // Iterator of the element of the set, stores the value itself, so it stays valid while this value is in the set
+    class iterator {
+      public:
+        iterator(const DenseIntegerSet* iterator_owner, size_t position)
+            : iterator_owner(iterator_owner)
+            , position(position)
+            , current_value(position == NPOS ? ValueType() : iterator_owner->Value(position))
+        {}
+
+        iterator() : iterator_owner(nullptr), position(NPOS), current_value() {}
+
+        const ValueType& operator*() const {
+            return current_value;
+        }
+
+        const ValueType* operator->() const {
+            return &current_value;
+        }
+
+        // Finds iterator of the next element by value, complexity O(log U / 6)
+        iterator& operator++() {
+            *this = iterator(iterator_owner, iterator_owner->NextSet(0, position + 1));
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator ans = *this;
+            ++*this;
+            return ans;
+        }
+
+        // Finds iterator of the previous element by value, complexity O(log U / 6)
+        iterator& operator--() {
+            if (position == NPOS) {
+                *this = iterator(iterator_owner, iterator_owner->PrevSet(0, iterator_owner->universe_size_ - 1));
+            } else {
+                *this = iterator(iterator_owner, position == 0 ? NPOS : iterator_owner->PrevSet(0, position - 1));
+            }
+            return *this;
+        }
+
+        iterator operator--(int) {
+            iterator ans = *this;
+            --*this;
+            return ans;
+        }
+
+        bool operator!=(const iterator& it) const {
+            return it.position != position || it.iterator_owner != iterator_owner;
+        }
+
+        bool operator==(const iterator& it) const {
+            return !(*this != it);
+        }
+
+      private:
+        const DenseIntegerSet* iterator_owner;
+        size_t position;
+        ValueType current_value;
+    };
+
+    // If given value isn't in the set - inserts it, returns iterator of element with given value and boolean that
+    // equals true if value was inserted, values out of the universe aren't inserted and end() is returned for them,
+    // complexity O(log U)
+    std::pair<iterator, bool> insert(const ValueType& value) {
+        size_t position = Position(value);
+        if (position == NPOS) {
+            return {end(), false};
+        }
+        if (Test(position)) {
+            return {iterator(this, position), false};
+        }
+        AddToBlock(position / BLOCK_BITS, 1);
+        for (auto& level: levels_) {
+            uint64_t& word = level[position / WORD_BITS];
+            bool was_empty = word == 0;
+            word |= uint64_t(1) << (position % WORD_BITS);
+            if (!was_empty) {
+                break;
+            }
+            position /= WORD_BITS;
+        }
+        ++set_size_;
+        return {iterator(this, Position(value)), true};
+    }
+
+    // If given value is in the set - erase it, returns amount of erased elements, complexity O(log U)
+    size_t erase(const ValueType& value) {
+        size_t position = Position(value);
+        if (position == NPOS || !Test(position)) {
+            return 0;
+        }
+        AddToBlock(position / BLOCK_BITS, -1);
+        for (auto& level: levels_) {
+            uint64_t& word = level[position / WORD_BITS];
+            word &= ~(uint64_t(1) << (position % WORD_BITS));
+            if (word != 0) {
+                break;
+            }
+            position /= WORD_BITS;
+        }
+        --set_size_;
+        return 1;
+    }
+
+    // If given value is in the set - returns iterator of the element with this value,
+    // else - returns end(), complexity O(1)
+    iterator find(const ValueType& value) const {
+        size_t position = Position(value);
+        if (position == NPOS || !Test(position)) {
+            return end();
+        }
+        return iterator(this, position);
+    }
+
+    // Returns iterator of the element with the smallest value not less, then given,
+    // or end() if this element doesn't exist, complexity O(log U / 6)
+    iterator lower_bound(const ValueType& value) const {
+        if (static_cast<uint64_t>(value) - static_cast<uint64_t>(lowest_) >= universe_size_) {
+            return value < lowest_ ? begin() : end();
+        }
+        return iterator(this, NextSet(0, Position(value)));
+    }
+
+    // Returns amount of elements of the set that are less than the given value: counts of the whole blocks of 64
+    // words before the value are summed in the tree of block counts, and the words of its block are counted with
+    // popcount, complexity O(log U) and at most 64 popcounts
+    size_t rank(const ValueType& value) const {
+        if (value < lowest_) {
+            return 0;
+        }
+        uint64_t position = static_cast<uint64_t>(value) - static_cast<uint64_t>(lowest_);
+        if (position >= universe_size_) {
+            return set_size_;
+        }
+        const std::vector<uint64_t>& words = levels_.front();
+        size_t ans = CountBlocksBefore(position / BLOCK_BITS);
+        for (size_t i = position / BLOCK_BITS * WORD_BITS; i < position / WORD_BITS; ++i) {
+            ans += PopCount(words[i]);
+        }
+        if (position % WORD_BITS != 0) {
+            ans += PopCount(words[position / WORD_BITS] & ~BitsFrom(position % WORD_BITS));
+        }
+        return ans;
+    }
+
+    // Returns iterator of the first element of the set, or end() if set is empty(), complexity O(log U / 6)
+    iterator begin() const {
+        return iterator(this, NextSet(0, 0));
+    }
+
+    // Returns iterator of the end of the set, complexity O(1)
+    iterator end() const {
+        return iterator(this, NPOS);
+    }
+
+    // Returns amount of elements the set contains, complexity O(1)
+    size_t size() const {
+        return set_size_;
+    }
+
+    // Returns true if set is empty, or false if it isn't, complexity O(1)
+    bool empty() const {
+        return size() == EMPTY_SIZE;
+    }
+
+    static constexpr size_t EMPTY_SIZE = 0;
+
+  private:
+    // Returns amount of values in [lowest, highest], complexity O(1)
+    static uint64_t UniverseSize(ValueType lowest, ValueType highest) {
+        if (highest < lowest) {
+            throw std::invalid_argument("DenseIntegerSet: highest value of the universe is less than the lowest");
+        }
+        uint64_t last = static_cast<uint64_t>(highest) - static_cast<uint64_t>(lowest);
+        if (last >= std::numeric_limits<size_t>::max()) {
+            throw std::length_error("DenseIntegerSet: universe is too large");
+        }
+        return last + 1;
+    }
+
+    // Adds delta to the count of elements of the given block of BLOCK_BITS values, block counts are kept in a
+    // Fenwick tree, complexity O(log U)
+    void AddToBlock(size_t block, int delta) {
+        for (++block; block < block_counts_.size(); block += block & (~block + 1)) {
+            block_counts_[block] += delta;
+        }
+    }
+
+    // Returns amount of elements in the blocks before the given one, complexity O(log U)
+    size_t CountBlocksBefore(size_t block) const {
+        size_t ans = 0;
+        for (; block > 0; block -= block & (~block + 1)) {
+            ans += block_counts_[block];
+        }
+        return ans;
+    }
+
+    // Returns index of the bit of the given value, or NPOS if value is out of the universe, complexity O(1)
+    size_t Position(ValueType value) const {
+        uint64_t position = static_cast<uint64_t>(value) - static_cast<uint64_t>(lowest_);
+        return position < universe_size_ ? static_cast<size_t>(position) : NPOS;
+    }
+
+    // Returns value with the bit of the given index, complexity O(1)
+    ValueType Value(size_t position) const {
+        return static_cast<ValueType>(static_cast<uint64_t>(lowest_) + position);
+    }
+
+    // Returns true if bit of the lowest level with the given index is set, complexity O(1)
+    bool Test(size_t position) const {
+        return (levels_.front()[position / WORD_BITS] >> (position % WORD_BITS) & 1) != 0;
+    }
+
+    // Returns index of the first set bit of the given level not less than the given index,
+    // or NPOS if it doesn't exist, complexity O(log U / 6)
+    size_t NextSet(size_t level, size_t position) const {
+        size_t word = position / WORD_BITS;
+        if (position == NPOS || word >= levels_[level].size()) {
+            return NPOS;
+        }
+        uint64_t bits = levels_[level][word] & BitsFrom(position % WORD_BITS);
+        if (bits != 0) {
+            return word * WORD_BITS + CountTrailingZeros(bits);
+        }
+        if (level + 1 == levels_.size()) {
+            return NPOS;
+        }
+        word = NextSet(level + 1, word + 1);
+        if (word == NPOS) {
+            return NPOS;
+        }
+        return word * WORD_BITS + CountTrailingZeros(levels_[level][word]);
+    }
+
+    // Returns index of the last set bit of the given level not greater than the given index,
+    // or NPOS if it doesn't exist, complexity O(log U / 6)
+    size_t PrevSet(size_t level, size_t position) const {
+        size_t word = position / WORD_BITS;
+        uint64_t bits = levels_[level][word] & BitsUpTo(position % WORD_BITS);
+        if (bits != 0) {
+            return word * WORD_BITS + HighestBit(bits);
+        }
+        if (level + 1 == levels_.size() || word == 0) {
+            return NPOS;
+        }
+        word = PrevSet(level + 1, word - 1);
+        if (word == NPOS) {
+            return NPOS;
+        }
+        return word * WORD_BITS + HighestBit(levels_[level][word]);
+    }
+
+    ValueType lowest_;
+    uint64_t universe_size_;
+    std::vector<std::vector<uint64_t>> levels_;
+    std::vector<size_t> block_counts_;
+    size_t set_size_ = EMPTY_SIZE;
+};
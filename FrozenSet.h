@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+
+// Immutable ordered set of at most N elements, stored as sorted array, so it can be built at compile time
+// with make_frozen_set and placed in read-only data without any static initialization. Needs C++14: values are kept
+// in a plain array, since mutable access to std::array is constexpr only since C++17
+template<typename ValueType, size_t N>
+class FrozenSet {
+  public:
+    using iterator = const ValueType*;
+
+    constexpr FrozenSet() = default;
+
+    // Creates set of the given values, duplicates are stored once, complexity O(N^2)
+    constexpr explicit FrozenSet(const ValueType (&values)[N]) {
+        for (size_t i = 0; i < N; ++i) {
+            size_t position = LowerBoundIndex(values[i]);
+            if (position < set_size_ && !(values[i] < values_[position])) {
+                continue;
+            }
+            for (size_t j = set_size_; j > position; --j) {
+                values_[j] = values_[j - 1];
+            }
+            values_[position] = values[i];
+            ++set_size_;
+        }
+    }
+
+    // If given value is in the set - returns iterator of the element with this value,
+    // else - returns end(), complexity O(log n)
+    constexpr iterator find(const ValueType& value) const {
+        size_t position = LowerBoundIndex(value);
+        if (position == set_size_ || value < values_[position]) {
+            return end();
+        }
+        return begin() + position;
+    }
+
+    // Returns iterator of the element with the smallest value not less, then given,
+    // or end() if this element doesn't exist, complexity O(log n)
+    constexpr iterator lower_bound(const ValueType& value) const {
+        return begin() + LowerBoundIndex(value);
+    }
+
+    // Returns iterator of the first element of the set, complexity O(1)
+    constexpr iterator begin() const {
+        return values_;
+    }
+
+    // Returns iterator of the end of the set, complexity O(1)
+    constexpr iterator end() const {
+        return values_ + set_size_;
+    }
+
+    // Returns amount of elements the set contains, complexity O(1)
+    constexpr size_t size() const {
+        return set_size_;
+    }
+
+    // Returns true if set is empty, or false if it isn't, complexity O(1)
+    constexpr bool empty() const {
+        return size() == EMPTY_SIZE;
+    }
+
+    static constexpr size_t EMPTY_SIZE = 0;
+
+  private:
+    // Returns index of the first stored value not less than the given one, complexity O(log n)
+    constexpr size_t LowerBoundIndex(const ValueType& value) const {
+        size_t left = 0;
+        size_t length = set_size_;
+        while (length > 0) {
+            size_t half = length / 2;
+            if (values_[left + half] < value) {
+                left += half + 1;
+                length -= half + 1;
+            } else {
+                length = half;
+            }
+        }
+        return left;
+    }
+
+    ValueType values_[N == 0 ? 1 : N]{};
+    size_t set_size_ = EMPTY_SIZE;
+};
+
+// Returns frozen set of the given values, evaluated at compile time when used to initialize constexpr variable:
+//     constexpr auto keywords = make_frozen_set<std::string_view>({"if", "else", "while"});
+template<typename ValueType, size_t N>
+constexpr FrozenSet<ValueType, N> make_frozen_set(const ValueType (&values)[N]) {
+    return FrozenSet<ValueType, N>(values);
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Means that memory may be placed on any NUMA node
+constexpr int ANY_NUMA_NODE = -1;
+
+// Size and alignment of the huge pages of x86-64 and most other platforms
+constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+// Asks the kernel to place pages of the given memory, which must be page-aligned and not touched yet, on the given
+// NUMA node, falling back to other nodes when it's full. Does nothing if the node is ANY_NUMA_NODE or the system
+// doesn't support memory policies, complexity O(1)
+inline void BindToNumaNode(void* memory, size_t size, int numa_node) {
+#if defined(__linux__) && defined(SYS_mbind)
+    constexpr int PREFERRED_POLICY = 1;
+    constexpr size_t MASK_BITS = 1024;
+    if (numa_node < 0 || static_cast<size_t>(numa_node) >= MASK_BITS) {
+        return;
+    }
+    unsigned long mask[MASK_BITS / (8 * sizeof(unsigned long))] = {};
+    mask[numa_node / (8 * sizeof(unsigned long))] = 1UL << (numa_node % (8 * sizeof(unsigned long)));
+    syscall(SYS_mbind, memory, size, PREFERRED_POLICY, mask, MASK_BITS, 0);
+#else
+    (void)memory;
+    (void)size;
+    (void)numa_node;
+#endif
+}
+
+// Maps anonymous memory of the given size, which must be a multiple of the huge page size, backed by huge pages:
+// explicitly reserved ones if there are any, otherwise transparent ones requested with madvise, otherwise regular
+// pages. Transparent huge pages back only aligned huge pages of the mapping, so for them the mapping is made one
+// huge page larger and trimmed to an aligned window. Pages are placed on the given NUMA node if it isn't
+// ANY_NUMA_NODE. Falls back to operator new on systems without mmap, complexity O(1)
+inline void* MapHugePages(size_t size, int numa_node = ANY_NUMA_NODE) {
+#if defined(__linux__)
+#if defined(MAP_HUGETLB)
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED) {
+        BindToNumaNode(memory, size, numa_node);
+        return memory;
+    }
+#endif
+    void* mapping = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    char* mapping_begin = static_cast<char*>(mapping);
+    size_t head = (HUGE_PAGE_SIZE - reinterpret_cast<uintptr_t>(mapping_begin) % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+    if (head != 0) {
+        munmap(mapping_begin, head);
+    }
+    munmap(mapping_begin + head + size, HUGE_PAGE_SIZE - head);
+    void* memory_without_reserve = mapping_begin + head;
+#if defined(MADV_HUGEPAGE)
+    madvise(memory_without_reserve, size, MADV_HUGEPAGE);
+#endif
+    BindToNumaNode(memory_without_reserve, size, numa_node);
+    return memory_without_reserve;
+#else
+    (void)numa_node;
+    return ::operator new(size);
+#endif
+}
+
+// Unmaps memory returned by MapHugePages with the same size, complexity O(1)
+inline void UnmapHugePages(void* memory, size_t size) {
+#if defined(__linux__)
+    munmap(memory, size);
+#else
+    (void)size;
+    ::operator delete(memory);
+#endif
+}
+
+// Pool of memory carved out of huge page chunks: small blocks are served by free lists of their size classes, so
+// vertexes of a tree are packed densely into few pages and random lookups miss the TLB rarely, large blocks are
+// mapped separately. Memory may be bound to a NUMA node. The pool isn't thread-safe, all memory is returned to the
+// system when it's destroyed
+class HugePagePool {
+  public:
+    explicit HugePagePool(size_t chunk_size = DEFAULT_CHUNK_SIZE, int numa_node = ANY_NUMA_NODE)
+        : chunk_size_(RoundUp(chunk_size, HUGE_PAGE_SIZE))
+        , numa_node_(numa_node)
+        , free_lists_(SMALL_LIMIT / GRANULARITY + 1, nullptr)
+    {}
+
+    HugePagePool(const HugePagePool&) = delete;
+    HugePagePool& operator=(const HugePagePool&) = delete;
+
+    ~HugePagePool() {
+        for (const Mapping& chunk: chunks_) {
+            UnmapHugePages(chunk.memory, chunk.size);
+        }
+    }
+
+    // Returns block of the given size aligned to 16 bytes, complexity O(1), amortized O(1) for the new chunks
+    void* Allocate(size_t size) {
+        size = RoundUp(std::max<size_t>(size, 1), GRANULARITY);
+        if (size > SMALL_LIMIT) {
+            return MapHugePages(RoundUp(size, HUGE_PAGE_SIZE), numa_node_);
+        }
+        FreeBlock*& free_list = free_lists_[size / GRANULARITY];
+        if (free_list != nullptr) {
+            FreeBlock* block = free_list;
+            free_list = block->next;
+            return block;
+        }
+        if (chunk_position_ + size > chunk_end_) {
+            chunks_.reserve(chunks_.size() + 1);
+            chunks_.push_back(Mapping{MapHugePages(chunk_size_, numa_node_), chunk_size_});
+            chunk_position_ = static_cast<char*>(chunks_.back().memory);
+            chunk_end_ = chunk_position_ + chunk_size_;
+        }
+        void* block = chunk_position_;
+        chunk_position_ += size;
+        return block;
+    }
+
+    // Returns block of the given size to the pool, complexity O(1)
+    void Deallocate(void* memory, size_t size) {
+        size = RoundUp(std::max<size_t>(size, 1), GRANULARITY);
+        if (size > SMALL_LIMIT) {
+            UnmapHugePages(memory, RoundUp(size, HUGE_PAGE_SIZE));
+            return;
+        }
+        FreeBlock* block = static_cast<FreeBlock*>(memory);
+        block->next = free_lists_[size / GRANULARITY];
+        free_lists_[size / GRANULARITY] = block;
+    }
+
+    size_t chunk_size() const {
+        return chunk_size_;
+    }
+
+    int numa_node() const {
+        return numa_node_;
+    }
+
+    static constexpr size_t HUGE_PAGE_SIZE = ::HUGE_PAGE_SIZE;
+    static constexpr size_t DEFAULT_CHUNK_SIZE = HUGE_PAGE_SIZE;
+    static constexpr size_t SMALL_LIMIT = 4096;
+    static constexpr size_t GRANULARITY = 16;
+
+  private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct Mapping {
+        void* memory;
+        size_t size;
+    };
+
+    static size_t RoundUp(size_t size, size_t alignment) {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    size_t chunk_size_;
+    int numa_node_;
+    std::vector<FreeBlock*> free_lists_;
+    std::vector<Mapping> chunks_;
+    char* chunk_position_ = nullptr;
+    char* chunk_end_ = nullptr;
+};
+
+// Allocator backed by the huge page pool, copies and rebound copies share the pool, while default constructed
+// allocators and the ones of copied containers create their own, so every
+// Set<ValueType, HugePageAllocator<ValueType>> keeps its vertexes in its own huge pages
+template<typename ValueType>
+class HugePageAllocator {
+  public:
+    using value_type = ValueType;
+
+    HugePageAllocator() : pool_(std::make_shared<HugePagePool>()) {}
+
+    explicit HugePageAllocator(std::shared_ptr<HugePagePool> pool) : pool_(std::move(pool)) {}
+
+    template<typename OtherType>
+    HugePageAllocator(const HugePageAllocator<OtherType>& other) : pool_(other.pool()) {}
+
+    HugePageAllocator select_on_container_copy_construction() const {
+        return HugePageAllocator(std::make_shared<HugePagePool>(pool_->chunk_size(), pool_->numa_node()));
+    }
+
+    ValueType* allocate(size_t count) {
+        static_assert(alignof(ValueType) <= HugePagePool::GRANULARITY, "Pool blocks are aligned to 16 bytes");
+        return static_cast<ValueType*>(pool_->Allocate(count * sizeof(ValueType)));
+    }
+
+    void deallocate(ValueType* memory, size_t count) {
+        pool_->Deallocate(memory, count * sizeof(ValueType));
+    }
+
+    const std::shared_ptr<HugePagePool>& pool() const {
+        return pool_;
+    }
+
+    template<typename OtherType>
+    bool operator==(const HugePageAllocator<OtherType>& other) const {
+        return pool_ == other.pool();
+    }
+
+    template<typename OtherType>
+    bool operator!=(const HugePageAllocator<OtherType>& other) const {
+        return pool_ != other.pool();
+    }
+
+  private:
+    std::shared_ptr<HugePagePool> pool_;
+};
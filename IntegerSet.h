@@ -0,0 +1,561 @@
+#pragma once
+
+#include "BitOperations.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Ordered set of unsigned integers with the same interface as Set, implemented with using radix tree with 64-way
+// bitmap nodes: every level consumes 6 bits of the value, so uint32_t keys need 6 levels and uint64_t keys need 11,
+// and every step of find and lower_bound is a couple of word operations instead of a comparison-based descent.
+// The tree is path-compressed: vertexes with a single child are skipped, so sparse keys cost one vertex each
+// instead of a chain of them, and the bitmaps of the last level are stored inline in the vertexes above it
+template<typename ValueType>
+class IntegerSet {
+    static_assert(std::is_integral<ValueType>::value && std::is_unsigned<ValueType>::value,
+                  "IntegerSet supports only unsigned integer values");
+
+  private:
+    static constexpr int DIGIT_BITS = 6;
+    static constexpr int VALUE_BITS = std::numeric_limits<ValueType>::digits;
+    static constexpr int DEPTH = (VALUE_BITS + DIGIT_BITS - 1) / DIGIT_BITS;
+    static constexpr uint64_t DIGIT_MASK = (uint64_t(1) << DIGIT_BITS) - 1;
+
+    struct Node;
+
+    // Slot of the child of the vertex, vertexes of the level above the last one keep the bitmaps of the last level,
+    // where bits are the last digits of the values, the other vertexes keep pointers to deeper vertexes
+    union Slot {
+        Node* child;
+        uint64_t bits;
+    };
+
+    // Vertex of the radix tree on the given level, prefix holds digits of its values above this level, bit i of the
+    // mask is set if subtree with digit i isn't empty. Slots of the children are allocated together with the vertex
+    // right after it, densely in order of digits, so child with digit i has index equal to amount of set bits
+    // below i. Every vertex above the bottom level has at least two children
+    struct Node {
+        uint64_t mask;
+        ValueType prefix;
+        uint8_t depth;
+        uint8_t capacity;
+    };
+
+    static constexpr int BOTTOM_DEPTH = DEPTH - 2;
+
+  public:
+    IntegerSet() = default;
+
+    template<typename FirstIterator, typename LastIterator>
+    IntegerSet(FirstIterator begin, LastIterator end) {
+        while (begin != end) {
+            Insert(*begin);
+            ++begin;
+        }
+    }
+
+    IntegerSet(std::initializer_list<ValueType> elements) {
+        for (const auto& value: elements) {
+            Insert(value);
+        }
+    }
+
+    IntegerSet(const IntegerSet& s) {
+        set_size_ = s.set_size_;
+        tree_root_ = Copy(s.tree_root_);
+    }
+
+    IntegerSet(IntegerSet&& s) {
+        std::swap(s.tree_root_, tree_root_);
+        std::swap(s.set_size_, set_size_);
+    }
+
+    IntegerSet& operator=(const IntegerSet& s) {
+        if (&s == this) {
+            return *this;
+        }
+        Delete(tree_root_);
+        set_size_ = s.set_size_;
+        tree_root_ = Copy(s.tree_root_);
+        return *this;
+    }
+
+    IntegerSet& operator=(IntegerSet&& s) {
+        std::swap(tree_root_, s.tree_root_);
+        std::swap(set_size_, s.set_size_);
+        return *this;
+    }
+
+    // Iterator of the element of the set, stores the value itself, so it stays valid while this value is in the set
+    class iterator {
+      public:
+        iterator(const IntegerSet* iterator_owner, ValueType current_value, bool is_end)
+            : iterator_owner(iterator_owner)
+            , current_value(is_end ? ValueType() : current_value)
+            , is_end(is_end)
+        {}
+
+        iterator() : iterator_owner(nullptr), current_value(), is_end(true) {}
+
+        const ValueType& operator*() const {
+            return current_value;
+        }
+
+        const ValueType* operator->() const {
+            return &current_value;
+        }
+
+        // Finds iterator of the next element by value, complexity O(log U / 6)
+        iterator& operator++() {
+            if (current_value == std::numeric_limits<ValueType>::max()) {
+                is_end = true;
+                current_value = ValueType();
+                return *this;
+            }
+            *this = iterator_owner->lower_bound(current_value + 1);
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator ans = *this;
+            ++*this;
+            return ans;
+        }
+
+        // Finds iterator of the previous element by value, complexity O(log U / 6)
+        iterator& operator--() {
+            ValueType bound = std::numeric_limits<ValueType>::max();
+            if (!is_end) {
+                bound = current_value - 1;
+            }
+            is_end = !iterator_owner->Predecessor(iterator_owner->tree_root_, bound, current_value);
+            return *this;
+        }
+
+        iterator operator--(int) {
+            iterator ans = *this;
+            --*this;
+            return ans;
+        }
+
+        bool operator!=(const iterator& it) const {
+            return it.iterator_owner != iterator_owner || it.is_end != is_end || it.current_value != current_value;
+        }
+
+        bool operator==(const iterator& it) const {
+            return !(*this != it);
+        }
+
+      private:
+        const IntegerSet* iterator_owner;
+        ValueType current_value;
+        bool is_end;
+    };
+
+    // If given value isn't in the set - inserts it, returns iterator of element with given value and boolean that
+    // equals true if value was inserted, complexity O(log U / 6)
+    std::pair<iterator, bool> insert(const ValueType& value) {
+        bool inserted = Insert(value);
+        return {iterator(this, value, false), inserted};
+    }
+
+    // If given value is in the set - erase it, returns amount of erased elements, complexity O(log U / 6)
+    size_t erase(const ValueType& value) {
+        if (!Erase(tree_root_, value)) {
+            return 0;
+        }
+        --set_size_;
+        return 1;
+    }
+
+    // If given value is in the set - returns iterator of the element with this value,
+    // else - returns end(), complexity O(log U / 6)
+    iterator find(const ValueType& value) const {
+        return iterator(this, value, !Contains(value));
+    }
+
+    // Returns iterator of the element with the smallest value not less, then given,
+    // or end() if this element doesn't exist, complexity O(log U / 6)
+    iterator lower_bound(const ValueType& value) const {
+        ValueType ans = ValueType();
+        bool found = tree_root_ != nullptr && LowerBound(tree_root_, value, ans);
+        return iterator(this, ans, !found);
+    }
+
+    // Returns iterator of the first element of the set, or end() if set is empty(), complexity O(log U / 6)
+    iterator begin() const {
+        return lower_bound(std::numeric_limits<ValueType>::min());
+    }
+
+    // Returns iterator of the end of the set, complexity O(1)
+    iterator end() const {
+        return iterator(this, ValueType(), true);
+    }
+
+    // Returns amount of elements the set contains, complexity O(1)
+    size_t size() const {
+        return set_size_;
+    }
+
+    // Returns true if set is empty, or false if it isn't, complexity O(1)
+    bool empty() const {
+        return size() == EMPTY_SIZE;
+    }
+
+    ~IntegerSet() {
+        Delete(tree_root_);
+    }
+
+    static constexpr size_t EMPTY_SIZE = 0;
+
+  private:
+    // Returns amount of value bits below the digit of the given level, complexity O(1)
+    static constexpr int Shift(int depth) {
+        return (DEPTH - 1 - depth) * DIGIT_BITS;
+    }
+
+    // Returns digit of the value on the given level, complexity O(1)
+    static int Digit(ValueType value, int depth) {
+        return static_cast<int>((uint64_t(value) >> Shift(depth)) & DIGIT_MASK);
+    }
+
+    // Returns value with digits above the given level taken from the given value, given digit on the given level
+    // and zero digits below it, complexity O(1)
+    static ValueType WithDigit(ValueType value, int depth, int digit) {
+        int high_shift = Shift(depth) + DIGIT_BITS;
+        uint64_t high = high_shift >= VALUE_BITS ? 0 : (uint64_t(value) >> high_shift) << high_shift;
+        return static_cast<ValueType>(high | (uint64_t(digit) << Shift(depth)));
+    }
+
+    // Returns index of the child with the given digit in the children of the vertex, complexity O(1)
+    static size_t ChildIndex(const Node* vertex, int digit) {
+        return PopCount(vertex->mask & ~BitsFrom(digit));
+    }
+
+    // Returns slots of the children of the vertex, which are placed right after it, complexity O(1)
+    static Slot* Slots(Node* vertex) {
+        return reinterpret_cast<Slot*>(vertex + 1);
+    }
+
+    static const Slot* Slots(const Node* vertex) {
+        return reinterpret_cast<const Slot*>(vertex + 1);
+    }
+
+    // Returns value of the vertex on the bottom level with the given digit of this level and the given last digit,
+    // complexity O(1)
+    static ValueType BottomValue(const Node* vertex, int digit, int last_digit) {
+        return WithDigit(WithDigit(vertex->prefix, BOTTOM_DEPTH, digit), DEPTH - 1, last_digit);
+    }
+
+    // Allocates vertex without children with room for the given amount of them, complexity O(1)
+    static Node* NewNode(int depth, ValueType prefix, size_t capacity) {
+        void* memory = ::operator new(sizeof(Node) + capacity * sizeof(Slot));
+        return new (memory) Node{0, prefix, static_cast<uint8_t>(depth), static_cast<uint8_t>(capacity)};
+    }
+
+    static void DeleteNode(Node* vertex) {
+        ::operator delete(vertex);
+    }
+
+    // Returns new vertex on the bottom level that contains only the given value, complexity O(1)
+    static Node* NewBottom(ValueType value) {
+        Node* vertex = NewNode(BOTTOM_DEPTH, WithDigit(value, BOTTOM_DEPTH, 0), 1);
+        vertex->mask = uint64_t(1) << Digit(value, BOTTOM_DEPTH);
+        Slots(vertex)[0].bits = uint64_t(1) << Digit(value, DEPTH - 1);
+        return vertex;
+    }
+
+    // Returns new vertex with the given vertexes as children on the highest level where their prefixes differ,
+    // complexity O(1)
+    static Node* Branch(Node* first, Node* second) {
+        int depth = DEPTH - 1 - HighestBit(uint64_t(first->prefix) ^ uint64_t(second->prefix)) / DIGIT_BITS;
+        Node* vertex = NewNode(depth, WithDigit(first->prefix, depth, 0), 2);
+        int first_digit = Digit(first->prefix, depth);
+        int second_digit = Digit(second->prefix, depth);
+        if (second_digit < first_digit) {
+            std::swap(first, second);
+        }
+        vertex->mask = uint64_t(1) << first_digit | uint64_t(1) << second_digit;
+        Slots(vertex)[0].child = first;
+        Slots(vertex)[1].child = second;
+        return vertex;
+    }
+
+    // Inserts slot of the child with the given digit, which the vertex doesn't have, returns the vertex, which is
+    // moved if it had no room for the child, complexity O(64)
+    static Node* InsertSlot(Node* vertex, int digit, Slot slot) {
+        size_t count = PopCount(vertex->mask);
+        if (count == vertex->capacity) {
+            vertex = Reallocate(vertex, std::min<size_t>(count * 2, DIGIT_MASK + 1));
+        }
+        size_t index = ChildIndex(vertex, digit);
+        Slot* slots = Slots(vertex);
+        std::memmove(slots + index + 1, slots + index, (count - index) * sizeof(Slot));
+        slots[index] = slot;
+        vertex->mask |= uint64_t(1) << digit;
+        return vertex;
+    }
+
+    // Removes slot of the child with the given digit, returns the vertex, which is moved if it became mostly empty,
+    // complexity O(64)
+    static Node* RemoveSlot(Node* vertex, int digit) {
+        size_t count = PopCount(vertex->mask);
+        size_t index = ChildIndex(vertex, digit);
+        Slot* slots = Slots(vertex);
+        std::memmove(slots + index, slots + index + 1, (count - index - 1) * sizeof(Slot));
+        vertex->mask &= ~(uint64_t(1) << digit);
+        if (count != 1 && (count - 1) * 4 <= vertex->capacity) {
+            vertex = Reallocate(vertex, vertex->capacity / 2);
+        }
+        return vertex;
+    }
+
+    // Moves the vertex to the new place with room for the given amount of children, complexity O(64)
+    static Node* Reallocate(Node* vertex, size_t capacity) {
+        Node* moved_vertex = NewNode(vertex->depth, vertex->prefix, capacity);
+        moved_vertex->mask = vertex->mask;
+        std::memcpy(Slots(moved_vertex), Slots(vertex), PopCount(vertex->mask) * sizeof(Slot));
+        DeleteNode(vertex);
+        return moved_vertex;
+    }
+
+    // Returns true if the set contains given value, complexity O(log U / 6)
+    bool Contains(ValueType value) const {
+        const Node* vertex = tree_root_;
+        while (vertex != nullptr && WithDigit(value, vertex->depth, 0) == vertex->prefix) {
+            int digit = Digit(value, vertex->depth);
+            if ((vertex->mask >> digit & 1) == 0) {
+                return false;
+            }
+            const Slot& slot = Slots(vertex)[ChildIndex(vertex, digit)];
+            if (vertex->depth == BOTTOM_DEPTH) {
+                return (slot.bits >> Digit(value, DEPTH - 1) & 1) != 0;
+            }
+            vertex = slot.child;
+        }
+        return false;
+    }
+
+    // Inserts value in the tree, returns true if it wasn't there, complexity O(log U / 6)
+    bool Insert(ValueType value) {
+        Node** link = &tree_root_;
+        while (*link != nullptr) {
+            Node* vertex = *link;
+            if (WithDigit(value, vertex->depth, 0) != vertex->prefix) {
+                *link = Branch(vertex, NewBottom(value));
+                ++set_size_;
+                return true;
+            }
+            int digit = Digit(value, vertex->depth);
+            Slot slot;
+            if ((vertex->mask >> digit & 1) != 0) {
+                Slot& child_slot = Slots(vertex)[ChildIndex(vertex, digit)];
+                if (vertex->depth != BOTTOM_DEPTH) {
+                    link = &child_slot.child;
+                    continue;
+                }
+                uint64_t bit = uint64_t(1) << Digit(value, DEPTH - 1);
+                if (child_slot.bits & bit) {
+                    return false;
+                }
+                child_slot.bits |= bit;
+            } else {
+                if (vertex->depth == BOTTOM_DEPTH) {
+                    slot.bits = uint64_t(1) << Digit(value, DEPTH - 1);
+                } else {
+                    slot.child = NewBottom(value);
+                }
+                *link = InsertSlot(vertex, digit, slot);
+            }
+            ++set_size_;
+            return true;
+        }
+        *link = NewBottom(value);
+        ++set_size_;
+        return true;
+    }
+
+    // Erases value from the subtree of the vertex in the given link, removes children that became empty and
+    // vertexes left with a single child, returns true if value was erased, complexity O(log U / 6)
+    static bool Erase(Node*& link, ValueType value) {
+        Node* vertex = link;
+        if (vertex == nullptr || WithDigit(value, vertex->depth, 0) != vertex->prefix) {
+            return false;
+        }
+        int digit = Digit(value, vertex->depth);
+        if ((vertex->mask >> digit & 1) == 0) {
+            return false;
+        }
+        Slot& slot = Slots(vertex)[ChildIndex(vertex, digit)];
+        if (vertex->depth == BOTTOM_DEPTH) {
+            uint64_t bit = uint64_t(1) << Digit(value, DEPTH - 1);
+            if ((slot.bits & bit) == 0) {
+                return false;
+            }
+            slot.bits &= ~bit;
+            if (slot.bits != 0) {
+                return true;
+            }
+        } else {
+            if (!Erase(slot.child, value)) {
+                return false;
+            }
+            if (slot.child != nullptr) {
+                return true;
+            }
+        }
+        vertex = RemoveSlot(vertex, digit);
+        if (vertex->mask == 0) {
+            DeleteNode(vertex);
+            link = nullptr;
+        } else if (vertex->depth != BOTTOM_DEPTH && PopCount(vertex->mask) == 1) {
+            link = Slots(vertex)[0].child;
+            DeleteNode(vertex);
+        } else {
+            link = vertex;
+        }
+        return true;
+    }
+
+    // Returns the smallest value in the subtree of the given vertex, complexity O(log U / 6)
+    static ValueType Minimum(const Node* vertex) {
+        while (vertex->depth != BOTTOM_DEPTH) {
+            vertex = Slots(vertex)[0].child;
+        }
+        return BottomValue(vertex, CountTrailingZeros(vertex->mask), CountTrailingZeros(Slots(vertex)[0].bits));
+    }
+
+    // Returns the largest value in the subtree of the given vertex, complexity O(log U / 6)
+    static ValueType Maximum(const Node* vertex) {
+        while (vertex->depth != BOTTOM_DEPTH) {
+            vertex = Slots(vertex)[PopCount(vertex->mask) - 1].child;
+        }
+        const Slot& slot = Slots(vertex)[PopCount(vertex->mask) - 1];
+        return BottomValue(vertex, HighestBit(vertex->mask), HighestBit(slot.bits));
+    }
+
+    // Finds the smallest value not less than the given one in the subtree of the given vertex, returns false if it
+    // doesn't exist, complexity O(log U / 6)
+    bool LowerBound(const Node* vertex, ValueType value, ValueType& ans) const {
+        ValueType prefix = WithDigit(value, vertex->depth, 0);
+        if (prefix != vertex->prefix) {
+            if (prefix > vertex->prefix) {
+                return false;
+            }
+            ans = Minimum(vertex);
+            return true;
+        }
+        int digit = Digit(value, vertex->depth);
+        if ((vertex->mask >> digit & 1) != 0) {
+            const Slot& slot = Slots(vertex)[ChildIndex(vertex, digit)];
+            if (vertex->depth != BOTTOM_DEPTH) {
+                if (LowerBound(slot.child, value, ans)) {
+                    return true;
+                }
+            } else {
+                uint64_t last_candidates = slot.bits & BitsFrom(Digit(value, DEPTH - 1));
+                if (last_candidates != 0) {
+                    ans = BottomValue(vertex, digit, CountTrailingZeros(last_candidates));
+                    return true;
+                }
+            }
+        }
+        uint64_t candidates = digit == int(DIGIT_MASK) ? 0 : vertex->mask & BitsFrom(digit + 1);
+        if (candidates == 0) {
+            return false;
+        }
+        int next_digit = CountTrailingZeros(candidates);
+        const Slot& slot = Slots(vertex)[ChildIndex(vertex, next_digit)];
+        if (vertex->depth != BOTTOM_DEPTH) {
+            ans = Minimum(slot.child);
+        } else {
+            ans = BottomValue(vertex, next_digit, CountTrailingZeros(slot.bits));
+        }
+        return true;
+    }
+
+    // Finds the largest value not greater than the given one in the subtree of the given vertex, returns false if
+    // it doesn't exist, complexity O(log U / 6)
+    bool Predecessor(const Node* vertex, ValueType value, ValueType& ans) const {
+        if (vertex == nullptr) {
+            return false;
+        }
+        ValueType prefix = WithDigit(value, vertex->depth, 0);
+        if (prefix != vertex->prefix) {
+            if (prefix < vertex->prefix) {
+                return false;
+            }
+            ans = Maximum(vertex);
+            return true;
+        }
+        int digit = Digit(value, vertex->depth);
+        if ((vertex->mask >> digit & 1) != 0) {
+            const Slot& slot = Slots(vertex)[ChildIndex(vertex, digit)];
+            if (vertex->depth != BOTTOM_DEPTH) {
+                if (Predecessor(slot.child, value, ans)) {
+                    return true;
+                }
+            } else {
+                uint64_t last_candidates = slot.bits & BitsUpTo(Digit(value, DEPTH - 1));
+                if (last_candidates != 0) {
+                    ans = BottomValue(vertex, digit, HighestBit(last_candidates));
+                    return true;
+                }
+            }
+        }
+        uint64_t candidates = digit == 0 ? 0 : vertex->mask & BitsUpTo(digit - 1);
+        if (candidates == 0) {
+            return false;
+        }
+        int previous_digit = HighestBit(candidates);
+        const Slot& slot = Slots(vertex)[ChildIndex(vertex, previous_digit)];
+        if (vertex->depth != BOTTOM_DEPTH) {
+            ans = Maximum(slot.child);
+        } else {
+            ans = BottomValue(vertex, previous_digit, HighestBit(slot.bits));
+        }
+        return true;
+    }
+
+    // Returns root of the copied version of the tree with the given root, complexity O(size of the tree)
+    static Node* Copy(const Node* vertex) {
+        if (vertex == nullptr) {
+            return nullptr;
+        }
+        Node* copied_vertex = NewNode(vertex->depth, vertex->prefix, vertex->capacity);
+        copied_vertex->mask = vertex->mask;
+        size_t count = PopCount(vertex->mask);
+        for (size_t i = 0; i < count; ++i) {
+            if (vertex->depth == BOTTOM_DEPTH) {
+                Slots(copied_vertex)[i].bits = Slots(vertex)[i].bits;
+            } else {
+                Slots(copied_vertex)[i].child = Copy(Slots(vertex)[i].child);
+            }
+        }
+        return copied_vertex;
+    }
+
+    // Deletes all vertexes of the tree with the given root, complexity O(size of the tree)
+    static void Delete(Node* vertex) {
+        if (vertex == nullptr) {
+            return;
+        }
+        if (vertex->depth != BOTTOM_DEPTH) {
+            size_t count = PopCount(vertex->mask);
+            for (size_t i = 0; i < count; ++i) {
+                Delete(Slots(vertex)[i].child);
+            }
+        }
+        DeleteNode(vertex);
+    }
+
+    Node* tree_root_ = nullptr;
+    size_t set_size_ = EMPTY_SIZE;
+};
@@ -0,0 +1,450 @@
+#pragma once
+
+#include "BloomFilter.h"
+#include "Set.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Log-structured set for workloads that don't fit in memory: inserts and erases go to the in-memory memtable, which
+// is flushed to an immutable sorted run on disk once it fills. Every run keeps in memory only a Bloom filter and the
+// first value of every block, so a lookup reads at most one block per run whose filter doesn't reject the value.
+// Once there are too many runs, they are merged into one by a background thread. Values are stored as raw bytes,
+// so the value type must be trivially copyable. Run files are named by a random tag of the set and created
+// exclusively, so several sets may share a directory
+template<typename ValueType>
+class LsmSet {
+    static_assert(std::is_trivially_copyable<ValueType>::value, "LsmSet stores values in the runs as raw bytes");
+
+  private:
+    static constexpr size_t RECORD_SIZE = sizeof(ValueType) + 1;
+    static constexpr size_t BLOCK_RECORDS = 256;
+
+    // Entry of the run, erased values are kept as records with the mark to hide older records of the same value
+    struct Record {
+        ValueType value;
+        bool is_erased;
+    };
+
+    // Immutable sorted file of records with the fence index and the filter of its values, the file is removed when
+    // the run isn't used anymore
+    struct Run {
+        std::string path;
+        size_t size = 0;
+        std::vector<ValueType> fences;
+        BloomFilter<ValueType> filter;
+        std::FILE* file = nullptr;
+
+        ~Run() {
+            if (file != nullptr) {
+                std::fclose(file);
+            }
+            std::remove(path.c_str());
+        }
+    };
+
+    using RunPointer = std::shared_ptr<Run>;
+
+  public:
+    // Creates empty set storing its runs in the given existing directory, memtable is flushed after the given
+    // amount of updates, runs are merged once there are more of them than given
+    explicit LsmSet(std::string directory, size_t memtable_capacity = DEFAULT_MEMTABLE_CAPACITY,
+                    size_t max_runs = DEFAULT_MAX_RUNS)
+        : directory_(std::move(directory))
+        , memtable_capacity_(std::max<size_t>(memtable_capacity, 1))
+        , max_runs_(std::max<size_t>(max_runs, 1))
+        , run_tag_(RandomTag())
+    {}
+
+    LsmSet(const LsmSet&) = delete;
+    LsmSet& operator=(const LsmSet&) = delete;
+
+    // Waits for the background compaction, its error is dropped, since the runs it was merging stay intact
+    ~LsmSet() {
+        if (compaction_thread_.joinable()) {
+            compaction_thread_.join();
+        }
+    }
+
+    // Inserts value in the set, complexity O(log m), amortized O(log m) disk writes for the flushes
+    void insert(const ValueType& value) {
+        erased_.erase(value);
+        inserted_.insert(value);
+        FlushIfFull();
+    }
+
+    // Erases value from the set, complexity O(log m), amortized O(log m) disk writes for the flushes
+    void erase(const ValueType& value) {
+        inserted_.erase(value);
+        erased_.insert(value);
+        FlushIfFull();
+    }
+
+    // Returns true if the set contains given value, complexity O(log m + r log n), at most one block read for
+    // every run whose filter doesn't reject the value
+    bool contains(const ValueType& value) const {
+        if (inserted_.find(value) != inserted_.end()) {
+            return true;
+        }
+        if (erased_.find(value) != erased_.end()) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(runs_mutex_);
+        for (auto run = runs_.rbegin(); run != runs_.rend(); ++run) {
+            bool is_erased = false;
+            if (FindInRun(**run, value, is_erased)) {
+                return !is_erased;
+            }
+        }
+        return false;
+    }
+
+    // Writes the memtable to a new run, complexity O(m) disk writes. Rethrows the error of the failed background
+    // compaction, if there was one since the previous call, before writing anything
+    void flush() {
+        RethrowCompactionError();
+        if (inserted_.empty() && erased_.empty()) {
+            return;
+        }
+        RunWriter writer(CreateRunFile(), inserted_.size() + erased_.size());
+        auto inserted = inserted_.begin();
+        auto erased = erased_.begin();
+        while (inserted != inserted_.end() || erased != erased_.end()) {
+            if (erased == erased_.end() || (inserted != inserted_.end() && *inserted < *erased)) {
+                writer.Append({*inserted++, false});
+            } else {
+                writer.Append({*erased++, true});
+            }
+        }
+        inserted_ = Set<ValueType>();
+        erased_ = Set<ValueType>();
+        RunPointer run = writer.Finish();
+        std::lock_guard<std::mutex> lock(runs_mutex_);
+        runs_.push_back(std::move(run));
+        if (runs_.size() > max_runs_ && !compaction_running_) {
+            StartCompaction();
+        }
+    }
+
+    // Flushes the memtable and merges all runs into one without erased values, rethrows the error of the failed
+    // background compaction, complexity O(n) disk reads and writes
+    void compact() {
+        WaitForCompaction();
+        flush();
+        WaitForCompaction();
+        std::vector<RunPointer> runs;
+        {
+            std::lock_guard<std::mutex> lock(runs_mutex_);
+            runs = runs_;
+        }
+        if (runs.size() <= 1) {
+            return;
+        }
+        RunPointer merged = Merge(runs);
+        std::lock_guard<std::mutex> lock(runs_mutex_);
+        ReplaceOldestRuns(runs.size(), std::move(merged));
+    }
+
+    // Returns amount of runs on disk, complexity O(1)
+    size_t run_count() const {
+        std::lock_guard<std::mutex> lock(runs_mutex_);
+        return runs_.size();
+    }
+
+    static constexpr size_t DEFAULT_MEMTABLE_CAPACITY = 1 << 20;
+    static constexpr size_t DEFAULT_MAX_RUNS = 8;
+
+  private:
+    // Created file of the new run opened for writing
+    struct RunFile {
+        std::string path;
+        std::FILE* file;
+    };
+
+    // Writes sorted records to the file of the new run, building its fence index and filter
+    class RunWriter {
+      public:
+        RunWriter(RunFile run_file, size_t expected_size)
+            : run_(std::make_shared<Run>())
+            , file_(run_file.file)
+        {
+            run_->path = std::move(run_file.path);
+            run_->filter = BloomFilter<ValueType>(expected_size);
+        }
+
+        ~RunWriter() {
+            if (file_ != nullptr) {
+                std::fclose(file_);
+            }
+        }
+
+        // Appends record, its value must be greater than values of the appended records, complexity O(1)
+        void Append(const Record& record) {
+            if (run_->size % BLOCK_RECORDS == 0) {
+                run_->fences.push_back(record.value);
+            }
+            run_->filter.Add(record.value);
+            unsigned char bytes[RECORD_SIZE];
+            std::memcpy(bytes, &record.value, sizeof(ValueType));
+            bytes[sizeof(ValueType)] = record.is_erased ? 1 : 0;
+            if (std::fwrite(bytes, RECORD_SIZE, 1, file_) != 1) {
+                throw std::runtime_error("LsmSet: can't write run file " + run_->path);
+            }
+            ++run_->size;
+        }
+
+        // Closes the file and reopens it for lookups, returns the written run, complexity O(1)
+        RunPointer Finish() {
+            bool is_written = std::fclose(file_) == 0;
+            file_ = nullptr;
+            run_->file = std::fopen(run_->path.c_str(), "rb");
+            if (!is_written || run_->file == nullptr) {
+                throw std::runtime_error("LsmSet: can't finish run file " + run_->path);
+            }
+            return std::move(run_);
+        }
+
+      private:
+        RunPointer run_;
+        std::FILE* file_ = nullptr;
+    };
+
+    // Sequential reader of the records of the run, uses its own file, so it can work in the other thread
+    class RunReader {
+      public:
+        explicit RunReader(const Run& run)
+            : file_(std::fopen(run.path.c_str(), "rb"))
+            , remaining_(run.size)
+        {
+            if (file_ == nullptr) {
+                throw std::runtime_error("LsmSet: can't open run file " + run.path);
+            }
+        }
+
+        RunReader(RunReader&& reader)
+            : file_(reader.file_)
+            , remaining_(reader.remaining_)
+            , current_(reader.current_)
+        {
+            reader.file_ = nullptr;
+        }
+
+        ~RunReader() {
+            if (file_ != nullptr) {
+                std::fclose(file_);
+            }
+        }
+
+        // Reads the next record, returns false if there are no more records, complexity O(1)
+        bool Next() {
+            if (remaining_ == 0) {
+                return false;
+            }
+            unsigned char bytes[RECORD_SIZE];
+            if (std::fread(bytes, RECORD_SIZE, 1, file_) != 1) {
+                throw std::runtime_error("LsmSet: can't read run file");
+            }
+            DecodeRecord(bytes, current_);
+            --remaining_;
+            return true;
+        }
+
+        const Record& Current() const {
+            return current_;
+        }
+
+      private:
+        std::FILE* file_;
+        size_t remaining_;
+        Record current_{};
+    };
+
+    // Decodes record from its bytes in the run file, complexity O(1)
+    static void DecodeRecord(const unsigned char* bytes, Record& record) {
+        std::memcpy(&record.value, bytes, sizeof(ValueType));
+        record.is_erased = bytes[sizeof(ValueType)] != 0;
+    }
+
+    // Looks for the value in the run, returns true if there is a record of it and sets is_erased from the record,
+    // complexity O(log n) and at most one block read
+    static bool FindInRun(const Run& run, const ValueType& value, bool& is_erased) {
+        if (!run.filter.MayContain(value)) {
+            return false;
+        }
+        auto fence = std::upper_bound(run.fences.begin(), run.fences.end(), value);
+        if (fence == run.fences.begin()) {
+            return false;
+        }
+        size_t block = fence - run.fences.begin() - 1;
+        size_t first_record = block * BLOCK_RECORDS;
+        size_t records = std::min(size_t(BLOCK_RECORDS), run.size - first_record);
+        std::vector<unsigned char> bytes(records * RECORD_SIZE);
+        if (std::fseek(run.file, static_cast<long>(first_record * RECORD_SIZE), SEEK_SET) != 0 ||
+            std::fread(bytes.data(), RECORD_SIZE, records, run.file) != records) {
+            throw std::runtime_error("LsmSet: can't read run file " + run.path);
+        }
+        size_t left = 0;
+        size_t right = records;
+        while (left < right) {
+            size_t middle = (left + right) / 2;
+            Record record;
+            DecodeRecord(bytes.data() + middle * RECORD_SIZE, record);
+            if (record.value < value) {
+                left = middle + 1;
+            } else if (value < record.value) {
+                right = middle;
+            } else {
+                is_erased = record.is_erased;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Merges the given runs, ordered from the oldest to the newest and starting with the oldest run of the set,
+    // into one run, newer records win and erased values are dropped, complexity O(n r) comparisons
+    RunPointer Merge(const std::vector<RunPointer>& runs) {
+        size_t expected_size = 0;
+        std::vector<RunReader> readers;
+        std::vector<bool> has_record;
+        for (const auto& run: runs) {
+            expected_size += run->size;
+            readers.emplace_back(*run);
+            has_record.push_back(readers.back().Next());
+        }
+        RunWriter writer(CreateRunFile(), expected_size);
+        while (true) {
+            size_t newest = readers.size();
+            for (size_t i = 0; i < readers.size(); ++i) {
+                if (has_record[i] && (newest == readers.size() ||
+                                      !(readers[newest].Current().value < readers[i].Current().value))) {
+                    newest = i;
+                }
+            }
+            if (newest == readers.size()) {
+                break;
+            }
+            Record record = readers[newest].Current();
+            for (size_t i = 0; i < readers.size(); ++i) {
+                while (has_record[i] && !(record.value < readers[i].Current().value)) {
+                    has_record[i] = readers[i].Next();
+                }
+            }
+            if (!record.is_erased) {
+                writer.Append(record);
+            }
+        }
+        return writer.Finish();
+    }
+
+    // Replaces the given amount of the oldest runs with the merged one, runs_mutex_ must be locked, complexity O(r)
+    void ReplaceOldestRuns(size_t count, RunPointer merged) {
+        runs_.erase(runs_.begin(), runs_.begin() + count);
+        if (merged->size != 0) {
+            runs_.insert(runs_.begin(), std::move(merged));
+        }
+    }
+
+    // Starts merging of all current runs in the background thread, runs_mutex_ must be locked, complexity O(r)
+    void StartCompaction() {
+        if (compaction_thread_.joinable()) {
+            compaction_thread_.join();
+        }
+        compaction_running_ = true;
+        std::vector<RunPointer> runs = runs_;
+        compaction_thread_ = std::thread([this, runs] {
+            RunPointer merged;
+            std::exception_ptr error;
+            try {
+                merged = Merge(runs);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(runs_mutex_);
+            if (error == nullptr) {
+                ReplaceOldestRuns(runs.size(), std::move(merged));
+            } else {
+                compaction_error_ = error;
+            }
+            compaction_running_ = false;
+        });
+    }
+
+    // Waits until the background compaction finishes, rethrows its error if it failed
+    void WaitForCompaction() {
+        if (compaction_thread_.joinable()) {
+            compaction_thread_.join();
+        }
+        RethrowCompactionError();
+    }
+
+    // Rethrows the error of the failed background compaction once, complexity O(1)
+    void RethrowCompactionError() {
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock(runs_mutex_);
+            std::swap(error, compaction_error_);
+        }
+        if (error != nullptr) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Flushes the memtable if it's full, complexity O(1) if it isn't
+    void FlushIfFull() {
+        if (inserted_.size() + erased_.size() >= memtable_capacity_) {
+            flush();
+        }
+    }
+
+    // Creates file for the new run named by the tag of the set, skipping names of the existing files, so runs of
+    // other sets in the directory and files left by crashed processes are never overwritten, complexity O(1)
+    RunFile CreateRunFile() {
+        while (true) {
+            std::string path = directory_ + "/run_" + run_tag_ + "_" + std::to_string(next_run_id_++) + ".lsm";
+            std::FILE* file = std::fopen(path.c_str(), "wbx");
+            if (file != nullptr) {
+                return RunFile{std::move(path), file};
+            }
+            if (errno != EEXIST) {
+                throw std::runtime_error("LsmSet: can't create run file " + path);
+            }
+        }
+    }
+
+    // Returns random hexadecimal tag that tells runs of this set from runs of the others, complexity O(1)
+    static std::string RandomTag() {
+        std::random_device device;
+        uint64_t tag = (static_cast<uint64_t>(device()) << 32) ^ device();
+        char digits[17];
+        std::snprintf(digits, sizeof(digits), "%016llx", static_cast<unsigned long long>(tag));
+        return digits;
+    }
+
+    std::string directory_;
+    size_t memtable_capacity_;
+    size_t max_runs_;
+    Set<ValueType> inserted_;
+    Set<ValueType> erased_;
+    std::vector<RunPointer> runs_;
+    mutable std::mutex runs_mutex_;
+    std::thread compaction_thread_;
+    std::atomic<bool> compaction_running_{false};
+    std::exception_ptr compaction_error_;
+    std::string run_tag_;
+    std::atomic<size_t> next_run_id_{0};
+};
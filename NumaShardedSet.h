@@ -0,0 +1,280 @@
+#pragma once
+
+#include "BloomFilter.h"
+#include "HugePageAllocator.h"
+#include "Set.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Returns CPUs of the given NUMA node listed in sysfs, or empty vector if they are unknown, complexity O(cpus)
+inline std::vector<int> NumaNodeCpus(int numa_node) {
+    std::vector<int> cpus;
+    std::ifstream list("/sys/devices/system/node/node" + std::to_string(numa_node) + "/cpulist");
+    std::string range;
+    while (std::getline(list, range, ',')) {
+        std::istringstream bounds(range);
+        int first = 0;
+        int last = 0;
+        char dash = 0;
+        if (!(bounds >> first)) {
+            continue;
+        }
+        if (!(bounds >> dash >> last)) {
+            last = first;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// Returns amount of NUMA nodes with CPUs, or 1 on systems without NUMA information, complexity O(nodes)
+inline int NumaNodeCount() {
+    int count = 0;
+    while (!NumaNodeCpus(count).empty()) {
+        ++count;
+    }
+    return std::max(count, 1);
+}
+
+// Pins the calling thread to the CPUs of the given NUMA node, does nothing if they are unknown, complexity O(cpus)
+inline void PinThreadToNumaNode(int numa_node) {
+#if defined(__linux__)
+    std::vector<int> cpus = NumaNodeCpus(numa_node);
+    if (cpus.empty()) {
+        return;
+    }
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu: cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &cpu_set);
+        }
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#else
+    (void)numa_node;
+#endif
+}
+
+// Thread-safe set partitioned by hash of the values into shards spread over the NUMA nodes: vertexes of every shard
+// are allocated in huge pages placed on its node, and batched lookups of the shard are served by its worker thread
+// pinned to the CPUs of the node, so the tree is walked without cross-socket memory accesses. Single operations run
+// in the calling thread under the lock of the shard. On machines with one node the set is a plain sharded set.
+// Value type must be hashable with std::hash
+template<typename ValueType>
+class NumaShardedSet {
+    static_assert(IsHashable<ValueType>::value, "NumaShardedSet requires std::hash of the value type");
+
+  private:
+    using ShardSet = Set<ValueType, HugePageAllocator<ValueType>>;
+
+    // Part of the set placed on one NUMA node with the queue of the tasks of its worker
+    struct Shard {
+        explicit Shard(int numa_node)
+            : numa_node(numa_node)
+            , set(HugePageAllocator<ValueType>(
+                  std::make_shared<HugePagePool>(HugePagePool::DEFAULT_CHUNK_SIZE, numa_node)))
+        {}
+
+        int numa_node;
+        std::mutex mutex;
+        ShardSet set;
+        std::mutex tasks_mutex;
+        std::condition_variable tasks_changed;
+        std::vector<std::function<void()>> tasks;
+        bool is_stopped = false;
+        std::thread worker;
+    };
+
+  public:
+    // Creates empty set with the given amount of shards on every NUMA node, or on every NUMA node the caller
+    // listed, and starts their workers
+    explicit NumaShardedSet(size_t shards_per_node = 1, std::vector<int> numa_nodes = {}) {
+        if (numa_nodes.empty()) {
+            int node_count = NumaNodeCount();
+            bool is_numa = node_count > 1;
+            for (int node = 0; node < node_count; ++node) {
+                numa_nodes.push_back(is_numa ? node : ANY_NUMA_NODE);
+            }
+        }
+        shards_per_node = std::max<size_t>(shards_per_node, 1);
+        for (size_t i = 0; i < shards_per_node * numa_nodes.size(); ++i) {
+            shards_.emplace_back(new Shard(numa_nodes[i % numa_nodes.size()]));
+        }
+        for (const auto& shard: shards_) {
+            Shard* served_shard = shard.get();
+            shard->worker = std::thread([served_shard] {
+                Serve(*served_shard);
+            });
+        }
+    }
+
+    NumaShardedSet(const NumaShardedSet&) = delete;
+    NumaShardedSet& operator=(const NumaShardedSet&) = delete;
+
+    ~NumaShardedSet() {
+        for (const auto& shard: shards_) {
+            {
+                std::lock_guard<std::mutex> lock(shard->tasks_mutex);
+                shard->is_stopped = true;
+            }
+            shard->tasks_changed.notify_one();
+        }
+        for (const auto& shard: shards_) {
+            shard->worker.join();
+        }
+    }
+
+    // If given value isn't in the set - inserts it, returns true if value was inserted, complexity O(log n)
+    bool insert(const ValueType& value) {
+        Shard& shard = ShardOf(value);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        size_t old_size = shard.set.size();
+        shard.set.insert(value);
+        return shard.set.size() != old_size;
+    }
+
+    // If given value is in the set - erase it, returns amount of erased elements, complexity O(log n)
+    size_t erase(const ValueType& value) {
+        Shard& shard = ShardOf(value);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.set.erase(value);
+    }
+
+    // Returns true if given value is in the set, complexity O(log n)
+    bool contains(const ValueType& value) const {
+        Shard& shard = ShardOf(value);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.set.find(value) != shard.set.end();
+    }
+
+    // Tells for every value of the given range whether it's in the set: values are grouped by shards and every
+    // group is looked up by the worker of its shard on its NUMA node, complexity O(k log n) spread over the workers
+    template<typename FirstIterator, typename LastIterator>
+    std::vector<bool> contains_batch(FirstIterator begin, LastIterator end) const {
+        std::vector<ValueType> values(begin, end);
+        std::vector<std::vector<size_t>> positions(shards_.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            positions[ShardIndex(values[i])].push_back(i);
+        }
+        std::vector<char> answers(values.size(), 0);
+        std::mutex done_mutex;
+        std::condition_variable done;
+        size_t pending = 0;
+        for (const auto& shard_positions: positions) {
+            pending += shard_positions.empty() ? 0 : 1;
+        }
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            if (positions[i].empty()) {
+                continue;
+            }
+            Shard& shard = *shards_[i];
+            const std::vector<size_t>& shard_positions = positions[i];
+            Submit(shard, [&shard, &shard_positions, &values, &answers, &done_mutex, &done, &pending] {
+                {
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    for (size_t position: shard_positions) {
+                        answers[position] = shard.set.find(values[position]) != shard.set.end();
+                    }
+                }
+                std::lock_guard<std::mutex> lock(done_mutex);
+                if (--pending == 0) {
+                    done.notify_one();
+                }
+            });
+        }
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done.wait(lock, [&pending] {
+            return pending == 0;
+        });
+        return std::vector<bool>(answers.begin(), answers.end());
+    }
+
+    // Returns amount of elements the set contains, complexity O(shards)
+    size_t size() const {
+        size_t ans = 0;
+        for (const auto& shard: shards_) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            ans += shard->set.size();
+        }
+        return ans;
+    }
+
+    // Returns true if set is empty, or false if it isn't, complexity O(shards)
+    bool empty() const {
+        return size() == 0;
+    }
+
+    // Returns amount of shards, complexity O(1)
+    size_t shard_count() const {
+        return shards_.size();
+    }
+
+    // Returns NUMA node of the given shard, or ANY_NUMA_NODE if the set doesn't place memory, complexity O(1)
+    int numa_node(size_t shard) const {
+        return shards_[shard]->numa_node;
+    }
+
+  private:
+    // Returns index of the shard of the given value, complexity O(1)
+    size_t ShardIndex(const ValueType& value) const {
+        return MixHash(static_cast<uint64_t>(std::hash<ValueType>()(value))) % shards_.size();
+    }
+
+    Shard& ShardOf(const ValueType& value) const {
+        return *shards_[ShardIndex(value)];
+    }
+
+    // Queues the task to the worker of the shard, complexity O(1)
+    static void Submit(Shard& shard, std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(shard.tasks_mutex);
+            shard.tasks.push_back(std::move(task));
+        }
+        shard.tasks_changed.notify_one();
+    }
+
+    // Runs tasks of the shard on the CPUs of its NUMA node until the set is destroyed
+    static void Serve(Shard& shard) {
+        if (shard.numa_node != ANY_NUMA_NODE) {
+            PinThreadToNumaNode(shard.numa_node);
+        }
+        std::vector<std::function<void()>> tasks;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(shard.tasks_mutex);
+                shard.tasks_changed.wait(lock, [&shard] {
+                    return shard.is_stopped || !shard.tasks.empty();
+                });
+                if (shard.tasks.empty()) {
+                    return;
+                }
+                tasks.swap(shard.tasks);
+            }
+            for (auto& task: tasks) {
+                task();
+            }
+            tasks.clear();
+        }
+    }
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
@@ -1,70 +1,205 @@
 #pragma once
 
+#include "BalancingPolicies.h"
+#include "BloomFilter.h"
+#include "SetTraits.h"
+#include "WorkStealingPool.h"
+
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <functional>
 #include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
 #include <utility>
+#include <vector>
 
-// Ordered set of elements with insert, erase, find and lower_bound methods, implemented with using AA-tree
-template<typename ValueType>
+// Ordered set of elements with insert, erase, find and lower_bound methods, implemented with using AA-tree or
+// another balanced search tree chosen by the balancing policy from BalancingPolicies.h, vertexes are allocated
+// with the given allocator rebound to the vertex type. Without parent links vertexes are smaller and rotations
+// write less, but moving an iterator and finger search descend from the root, so they take O(log n) each
+template<typename ValueType, typename Allocator = std::allocator<ValueType>, bool HasParentLinks = true,
+         typename Balance = AaBalance>
 class Set {
   private:
-    // Vertex of the AA-tree
-    struct Node {
+    // Vertex of the tree, level is the rank of the balancing policy, for value types with key prefixes it caches
+    // prefix of its value, lazily erased vertexes stay in the tree marked as tombstones until compaction. The mark
+    // takes the top bit of the level word, so tombstones cost no space
+    struct Node : NodeKeyPrefix<ValueType>, NodeParentLink<Node, HasParentLinks> {
         ValueType value;
-        size_t level = BASIC_LEVEL;
-        Node* parent = nullptr;
+        size_t level : std::numeric_limits<size_t>::digits - 1;
+        size_t is_tombstone : 1;
         Node* left_son = nullptr;
         Node* right_son = nullptr;
 
         static constexpr size_t BASIC_LEVEL = 1;
 
-        Node(const ValueType& value)
+        AA_SET_CONSTEXPR Node(const ValueType& value)
             : value(value)
-        {}
+            , level(BASIC_LEVEL)
+            , is_tombstone(false)
+        {
+            this->SetPrefix(value);
+        }
+
+        AA_SET_CONSTEXPR Node(ValueType&& value)
+            : value(std::move(value))
+            , level(BASIC_LEVEL)
+            , is_tombstone(false)
+        {
+            this->SetPrefix(this->value);
+        }
+    };
+
+    using Key = SearchKey<ValueType>;
+
+    using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+
+    using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+    using Filter = BloomFilter<ValueType, FilterHash<ValueType>>;
+
+    // Approximate membership filter of the elements, erased values stay in it until it's rebuilt
+    struct MembershipFilter {
+        Filter filter;
+        size_t capacity;
+        size_t bits_per_element;
+        size_t stale_erases;
+    };
+
+    // Direct-mapped cache of the vertexes found by find(), slot of the vertex is determined by the hash of its
+    // value. Slots are written by const find(), so they are relaxed atomics to keep concurrent lookups race-free
+    struct LookupCache {
+        explicit LookupCache(size_t size) : slots(size), mask(size - 1) {}
+
+        std::vector<std::atomic<const Node*>> slots;
+        size_t mask;
+    };
+
+    // Contiguous storage of the vertexes placed by relayout(), slots of deleted vertexes are reused by new ones
+    struct Arena {
+        Node* nodes;
+        size_t capacity;
+        std::vector<Node*> free_slots;
     };
 
   public:
     Set() = default;
 
+    AA_SET_CONSTEXPR explicit Set(const Allocator& allocator) : node_allocator_(allocator) {}
+
     template<typename FirstIterator, typename LastIterator>
-    Set(FirstIterator begin, LastIterator end) {
+    AA_SET_CONSTEXPR Set(FirstIterator begin, LastIterator end) {
         while (begin != end) {
             Node* inserted_node = nullptr;
-            tree_root_ = Insert(tree_root_, *begin, inserted_node);
+            tree_root_ = Insert(tree_root_, Key(*begin), inserted_node);
             ++begin;
         }
     }
 
-    Set(std::initializer_list<ValueType> elements) {
+    AA_SET_CONSTEXPR Set(std::initializer_list<ValueType> elements) {
         for (const auto& value: elements) {
             Node* inserted_node = nullptr;
-            tree_root_ = Insert(tree_root_, value, inserted_node);
+            tree_root_ = Insert(tree_root_, Key(value), inserted_node);
+        }
+    }
+
+    AA_SET_CONSTEXPR Set(const Set& s)
+        : node_allocator_(NodeTraits::select_on_container_copy_construction(s.node_allocator_))
+    {
+        set_size_ = s.set_size_;
+        tombstones_ = s.tombstones_;
+        std::vector<Node*> recycled;
+        tree_root_ = Copy(s.tree_root_, recycled);
+        retained_nodes_limit_ = s.retained_nodes_limit_;
+        if (s.membership_filter_ != nullptr) {
+            membership_filter_ = new MembershipFilter(*s.membership_filter_);
+        }
+        if (s.lookup_cache_ != nullptr) {
+            AllocateLookupCache(s.lookup_cache_->slots.size());
         }
     }
 
-    Set(const Set& s) {
+    // Copies the given set, vertexes are copied in parallel on the executor if the allocator is concurrent,
+    // complexity O(n) work and O(log n) depth
+    template<typename Executor>
+    Set(const Set& s, Executor& executor)
+        : node_allocator_(NodeTraits::select_on_container_copy_construction(s.node_allocator_))
+    {
         set_size_ = s.set_size_;
-        tree_root_ = Copy(s.tree_root_);
+        tombstones_ = s.tombstones_;
+        BudgetOf<Executor> budget = RootForkBudget(executor);
+        if (!CanAllocateConcurrently()) {
+            budget.depth = 0;
+        }
+        tree_root_ = Copy(s.tree_root_, budget);
+        retained_nodes_limit_ = s.retained_nodes_limit_;
+        if (s.membership_filter_ != nullptr) {
+            membership_filter_ = new MembershipFilter(*s.membership_filter_);
+        }
+        if (s.lookup_cache_ != nullptr) {
+            AllocateLookupCache(s.lookup_cache_->slots.size());
+        }
     }
 
-    Set(Set&& s) {
+    // Creates set of the values of the given range in any order like insert_batch() on the executor
+    template<typename Executor, typename FirstIterator, typename LastIterator>
+    Set(Executor& executor, FirstIterator begin, LastIterator end) {
+        insert_batch(executor, begin, end);
+    }
+
+    AA_SET_CONSTEXPR Set(Set&& s) {
         std::swap(s.tree_root_, tree_root_);
+        std::swap(s.tombstones_, tombstones_);
+        std::swap(s.membership_filter_, membership_filter_);
+        std::swap(s.lookup_cache_, lookup_cache_);
+        std::swap(s.arena_, arena_);
+        std::swap(s.node_allocator_, node_allocator_);
+        std::swap(s.retained_nodes_, retained_nodes_);
+        std::swap(s.retained_nodes_limit_, retained_nodes_limit_);
         set_size_ = s.set_size_;
     }
 
-    Set& operator=(const Set& s) {
+    AA_SET_CONSTEXPR Set& operator=(const Set& s) {
         if (&s == this) {
             return *this;
         }
-        Delete(tree_root_);
+        ClearLookupCache();
+        std::vector<Node*> recycled;
+        recycled.reserve(set_size_ + tombstones_);
+        TakeVertexes(tree_root_, recycled);
+        std::reverse(recycled.begin(), recycled.end());
         set_size_ = s.set_size_;
-        tree_root_ = Copy(s.tree_root_);
+        tombstones_ = s.tombstones_;
+        tree_root_ = Copy(s.tree_root_, recycled);
+        retain_nodes(s.retained_nodes_limit_);
+        for (Node* vertex: recycled) {
+            FreeNode(vertex);
+        }
+        delete membership_filter_;
+        membership_filter_ = nullptr;
+        if (s.membership_filter_ != nullptr) {
+            membership_filter_ = new MembershipFilter(*s.membership_filter_);
+        }
+        delete lookup_cache_;
+        lookup_cache_ = nullptr;
+        if (s.lookup_cache_ != nullptr) {
+            AllocateLookupCache(s.lookup_cache_->slots.size());
+        }
         return *this;
     }
 
-    Set& operator=(Set&& s) {
+    AA_SET_CONSTEXPR Set& operator=(Set&& s) {
         std::swap(tree_root_, s.tree_root_);
+        std::swap(tombstones_, s.tombstones_);
+        std::swap(membership_filter_, s.membership_filter_);
+        std::swap(lookup_cache_, s.lookup_cache_);
+        std::swap(arena_, s.arena_);
+        std::swap(node_allocator_, s.node_allocator_);
+        std::swap(retained_nodes_, s.retained_nodes_);
+        std::swap(retained_nodes_limit_, s.retained_nodes_limit_);
         set_size_ = s.set_size_;
         return *this;
     }
@@ -72,218 +207,651 @@ class Set {
     // Iterator of the element of the set
     class iterator {
       public:
-        iterator(const Set* iterator_owner, const Node* current_vertex)
+        AA_SET_CONSTEXPR iterator(const Set* iterator_owner, const Node* current_vertex)
             : iterator_owner(iterator_owner)
             , current_vertex(current_vertex)
         {}
 
-        iterator(const iterator& it)
+        AA_SET_CONSTEXPR iterator(const iterator& it)
             : iterator_owner(it.iterator_owner)
             , current_vertex(it.current_vertex)
         {}
 
-        iterator() : iterator_owner(nullptr), current_vertex(nullptr) {}
+        AA_SET_CONSTEXPR iterator() : iterator_owner(nullptr), current_vertex(nullptr) {}
 
-        iterator& operator=(const iterator& it) {
+        AA_SET_CONSTEXPR iterator& operator=(const iterator& it) {
             iterator_owner = it.iterator_owner;
             current_vertex = it.current_vertex;
             return *this;
         }
 
-        const ValueType& operator*() const {
+        AA_SET_CONSTEXPR const ValueType& operator*() const {
             return current_vertex->value;
         }
 
-        const ValueType* operator->() const {
+        AA_SET_CONSTEXPR const ValueType* operator->() const {
             return &current_vertex->value;
         }
 
         // Finds iterator of the next element by value, complexity O(log n), average complexity O(1)
-        iterator& operator++() {
-            current_vertex = iterator_owner->Next(current_vertex);
+        AA_SET_CONSTEXPR iterator& operator++() {
+            current_vertex = iterator_owner->SkipTombstones(iterator_owner->Next(current_vertex));
             return *this;
         }
 
-        iterator operator++(int) {
+        AA_SET_CONSTEXPR iterator operator++(int) {
             iterator ans = *this;
-            current_vertex = iterator_owner->Next(current_vertex);
+            current_vertex = iterator_owner->SkipTombstones(iterator_owner->Next(current_vertex));
             return ans;
         }
 
         // Finds iterator of the previous element by value, complexity O(log n), average complexity O(1)
-        iterator& operator--() {
+        AA_SET_CONSTEXPR iterator& operator--() {
             if (current_vertex == nullptr) {
                 current_vertex = iterator_owner->tree_root_;
                 while (current_vertex->right_son != nullptr) {
                     current_vertex = current_vertex->right_son;
                 }
+                current_vertex = iterator_owner->SkipTombstonesBackward(current_vertex);
                 return *this;
             }
-            current_vertex = iterator_owner->Prev(current_vertex);
+            current_vertex = iterator_owner->SkipTombstonesBackward(iterator_owner->Prev(current_vertex));
             return *this;
         }
 
-        iterator operator--(int) {
+        AA_SET_CONSTEXPR iterator operator--(int) {
             iterator ans = *this;
             if (current_vertex == nullptr) {
                 current_vertex = iterator_owner->tree_root_;
                 while (current_vertex->right_son != nullptr) {
                     current_vertex = current_vertex->right_son;
                 }
-                return *this;
+                current_vertex = iterator_owner->SkipTombstonesBackward(current_vertex);
+                return ans;
             }
-            current_vertex = iterator_owner->Prev(current_vertex);
+            current_vertex = iterator_owner->SkipTombstonesBackward(iterator_owner->Prev(current_vertex));
             return ans;
 
         }
 
-        bool operator!=(const iterator& it) const {
+        AA_SET_CONSTEXPR bool operator!=(const iterator& it) const {
             return it.current_vertex != current_vertex || it.iterator_owner != iterator_owner;
         }
 
-        bool operator==(const iterator& it) const {
+        AA_SET_CONSTEXPR bool operator==(const iterator& it) const {
             return !(*this != it);
         }
 
       private:
+        friend class Set;
+
         const Set* iterator_owner;
         const Node* current_vertex;
     };
 
     // If given value isn't in the set - inserts it, returns iterator of element with given value and boolean that
     // equals true if value was inserted, complexity O(log n)
-    std::pair<iterator, bool> insert(const ValueType& value) {
+    AA_SET_CONSTEXPR std::pair<iterator, bool> insert(const ValueType& value) {
         Node* inserted_vertex = nullptr;
         size_t previous_size = set_size_;
-        tree_root_ = Insert(tree_root_, value, inserted_vertex);
+        tree_root_ = Insert(tree_root_, Key(value), inserted_vertex);
+        MaintainFilter();
         return {iterator(this, inserted_vertex), set_size_ == previous_size};
     }
 
+    // Inserts values of the given range, which must be sorted and must allow multiple passes, returns amount of
+    // inserted elements. Small ranges are inserted one by one, large ones are merged with the elements of the set
+    // in a single pass that rebuilds the tree perfectly balanced, complexity O(min(k log n, n + k))
+    template<typename FirstIterator, typename LastIterator>
+    AA_SET_CONSTEXPR size_t insert_sorted(FirstIterator begin, LastIterator end) {
+        size_t previous_size = set_size_;
+        size_t count = std::distance(begin, end);
+        if (count * TreeHeight() < set_size_ + count) {
+            for (; begin != end; ++begin) {
+                Node* inserted_vertex = nullptr;
+                tree_root_ = Insert(tree_root_, Key(*begin), inserted_vertex);
+            }
+            MaintainFilter();
+            return set_size_ - previous_size;
+        }
+        std::vector<Node*> existing;
+        existing.reserve(set_size_);
+        TakeAliveVertexes(tree_root_, existing);
+        tombstones_ = 0;
+        std::vector<Node*> vertexes;
+        vertexes.reserve(set_size_ + count);
+        auto current = existing.begin();
+        while (begin != end) {
+            Key key(*begin);
+            int order = current == existing.end() ? -1 : Compare(key, *current);
+            if (order > 0) {
+                vertexes.push_back(*current++);
+                continue;
+            }
+            if (order == 0) {
+                vertexes.push_back(*current++);
+            } else if (vertexes.empty() || Compare(key, vertexes.back()) != 0) {
+                vertexes.push_back(NewNode(key.value));
+                AddToFilter(key.value);
+                ++set_size_;
+            }
+            ++begin;
+        }
+        vertexes.insert(vertexes.end(), current, existing.end());
+        tree_root_ = BuildBalanced(vertexes.data(), vertexes.size(), nullptr);
+        MaintainFilter();
+        return set_size_ - previous_size;
+    }
+
     // If given value is in the set - erase it, returns amount of erased elements, complexity O(log n)
-    size_t erase(const ValueType& value) {
+    AA_SET_CONSTEXPR size_t erase(const ValueType& value) {
         size_t previous_size = set_size_;
-        tree_root_ = Erase(tree_root_, value);
+        tree_root_ = Erase(tree_root_, Key(value));
+        NoteFilterErases(previous_size - set_size_);
         return previous_size - set_size_;
     }
 
+    // Erases values of the given range, which must be sorted and must allow multiple passes, returns amount of
+    // erased elements. Small ranges are erased one by one, large ones are matched against the elements of the set
+    // in a single pass that rebuilds the tree perfectly balanced, complexity O(min(k log n, n + k))
+    template<typename FirstIterator, typename LastIterator>
+    AA_SET_CONSTEXPR size_t erase_sorted(FirstIterator begin, LastIterator end) {
+        size_t previous_size = set_size_;
+        size_t count = std::distance(begin, end);
+        if (count * TreeHeight() < set_size_ + count) {
+            for (; begin != end; ++begin) {
+                tree_root_ = Erase(tree_root_, Key(*begin));
+            }
+            NoteFilterErases(previous_size - set_size_);
+            return previous_size - set_size_;
+        }
+        std::vector<Node*> existing;
+        existing.reserve(set_size_);
+        TakeAliveVertexes(tree_root_, existing);
+        tombstones_ = 0;
+        size_t kept = 0;
+        for (Node* vertex: existing) {
+            int order = -1;
+            while (begin != end && (order = Compare(Key(*begin), vertex)) < 0) {
+                ++begin;
+            }
+            if (begin != end && order == 0) {
+                DeleteNode(vertex);
+                --set_size_;
+            } else {
+                existing[kept++] = vertex;
+            }
+        }
+        tree_root_ = BuildBalanced(existing.data(), kept, nullptr);
+        NoteFilterErases(previous_size - set_size_);
+        return previous_size - set_size_;
+    }
+
+    // Inserts values of the given range in any order, sorts and deduplicates them first, so they are applied as
+    // a single sorted batch, returns amount of inserted elements, complexity O(k log k + min(k log n, n + k))
+    template<typename FirstIterator, typename LastIterator>
+    AA_SET_CONSTEXPR size_t insert_batch(FirstIterator begin, LastIterator end) {
+        std::vector<ValueType> values = SortedUnique(begin, end);
+        return insert_sorted(values.begin(), values.end());
+    }
+
+    // Erases values of the given range in any order, sorts and deduplicates them first, so they are applied as
+    // a single sorted batch, returns amount of erased elements, complexity O(k log k + min(k log n, n + k))
+    template<typename FirstIterator, typename LastIterator>
+    AA_SET_CONSTEXPR size_t erase_batch(FirstIterator begin, LastIterator end) {
+        std::vector<ValueType> values = SortedUnique(begin, end);
+        return erase_sorted(values.begin(), values.end());
+    }
+
+#if defined(AA_SET_HAS_SPAN)
+    // Inserts values of the given span in any order as a single sorted batch, returns amount of inserted elements,
+    // complexity O(k log k + min(k log n, n + k))
+    AA_SET_CONSTEXPR size_t insert_batch(std::span<const ValueType> values) {
+        return insert_batch(values.begin(), values.end());
+    }
+
+    // Erases values of the given span in any order as a single sorted batch, returns amount of erased elements,
+    // complexity O(k log k + min(k log n, n + k))
+    AA_SET_CONSTEXPR size_t erase_batch(std::span<const ValueType> values) {
+        return erase_batch(values.begin(), values.end());
+    }
+#endif
+
+    // If given value is in the set - marks its vertex as a tombstone without rebalancing the tree, returns amount
+    // of erased elements. Tombstones are skipped by lookups and iteration and removed by compact(), which runs
+    // automatically once tombstones outnumber the elements, complexity O(log n), amortized O(log n)
+    AA_SET_CONSTEXPR size_t lazy_erase(const ValueType& value) {
+        Node* vertex = const_cast<Node*>(Find(tree_root_, Key(value)));
+        if (vertex == nullptr || vertex->is_tombstone) {
+            return 0;
+        }
+        vertex->is_tombstone = true;
+        --set_size_;
+        ++tombstones_;
+        if (tombstones_ > set_size_) {
+            compact();
+        } else {
+            NoteFilterErases(1);
+        }
+        return 1;
+    }
+
+    // Removes all tombstones and rebuilds the tree perfectly balanced, iterators of the elements stay valid,
+    // rebuilds the membership filter if it's enabled, complexity O(n)
+    AA_SET_CONSTEXPR void compact() {
+        if (membership_filter_ != nullptr) {
+            RebuildFilter();
+        }
+        RemoveTombstones();
+    }
+
+    // Erases all elements, memory of the vertexes is kept for the next inserts as far as the retention limit allows,
+    // complexity O(n)
+    AA_SET_CONSTEXPR void clear() {
+        ClearLookupCache();
+        Delete(tree_root_);
+        tree_root_ = nullptr;
+        set_size_ = EMPTY_SIZE;
+        tombstones_ = 0;
+        if (membership_filter_ != nullptr) {
+            RebuildFilter();
+        }
+    }
+
+    // Adds elements of the given set to this one, vertexes of the given set move to this set unless it has another
+    // allocator or relayouted vertexes, then they are copied first. The given set is split by the value of the root,
+    // both halves of the trees are united in parallel on the executor and joined back, iterators of the elements of
+    // this set stay valid, complexity O(m log(n / m + 1)) work and O(log^2 n) depth, where m is the size of the
+    // smaller set
+    template<typename Executor>
+    void unite(Executor& executor, Set other) {
+        BudgetOf<Executor> budget = RootForkBudget(executor);
+        size_t other_size = 0;
+        Node* other_root = TakeTree(other, other_size);
+        std::vector<Node*> garbage;
+        tree_root_ = Unite(tree_root_, other_root, garbage, budget);
+        FinishParallelOperation(set_size_ + other_size, garbage, budget);
+        if (membership_filter_ != nullptr) {
+            RebuildFilter();
+        }
+    }
+
+    // Keeps only elements of this set that the given set contains, the same way as unite(), complexity
+    // O(m log(n / m + 1)) work and O(log^2 n) depth
+    template<typename Executor>
+    void intersect(Executor& executor, Set other) {
+        BudgetOf<Executor> budget = RootForkBudget(executor);
+        size_t previous_size = set_size_;
+        size_t other_size = 0;
+        Node* other_root = TakeTree(other, other_size);
+        std::vector<Node*> garbage;
+        tree_root_ = Intersect(tree_root_, other_root, garbage, budget);
+        FinishParallelOperation(set_size_ + other_size, garbage, budget);
+        NoteFilterErases(previous_size - set_size_);
+    }
+
+    // Erases elements of this set that the given set contains, the same way as unite(), complexity
+    // O(m log(n / m + 1)) work and O(log^2 n) depth
+    template<typename Executor>
+    void subtract(Executor& executor, Set other) {
+        BudgetOf<Executor> budget = RootForkBudget(executor);
+        size_t previous_size = set_size_;
+        size_t other_size = 0;
+        Node* other_root = TakeTree(other, other_size);
+        std::vector<Node*> garbage;
+        tree_root_ = Subtract(tree_root_, other_root, garbage, budget);
+        FinishParallelOperation(set_size_ + other_size, garbage, budget);
+        NoteFilterErases(previous_size - set_size_);
+    }
+
+    // Erases elements that satisfy the given predicate, returns amount of erased elements. Both subtrees of every
+    // vertex are filtered in parallel on the executor and joined back, so the predicate is called concurrently and
+    // must not throw, iterators of the remaining elements stay valid, complexity O(n) work and O(log^2 n) depth
+    template<typename Executor, typename Predicate>
+    size_t erase_if(Executor& executor, const Predicate& predicate) {
+        BudgetOf<Executor> budget = RootForkBudget(executor);
+        size_t previous_size = set_size_;
+        RemoveTombstones();
+        std::vector<Node*> garbage;
+        tree_root_ = EraseIf(tree_root_, predicate, garbage, budget);
+        FinishParallelOperation(set_size_, garbage, budget);
+        NoteFilterErases(previous_size - set_size_);
+        return previous_size - set_size_;
+    }
+
+    // Returns reduce of map of the elements in order of values, starting from identity: both subtrees of every
+    // vertex are reduced in parallel on the executor, so map and reduce are called concurrently, reduce must be
+    // associative and identity must be its neutral element, complexity O(n) work and O(log n) depth
+    template<typename Executor, typename Result, typename Map, typename Reduce>
+    Result map_reduce(Executor& executor, const Map& map, const Reduce& reduce, Result identity) const {
+        return MapReduce(tree_root_, map, reduce, identity, RootForkBudget(executor));
+    }
+
+    // Calls the given function for every element, both subtrees of every vertex are visited in parallel on the
+    // executor, so the function is called concurrently and in no particular order, complexity O(n) work and
+    // O(log n) depth
+    template<typename Executor, typename Function>
+    void for_each(Executor& executor, const Function& function) const {
+        ForEach(tree_root_, function, RootForkBudget(executor));
+    }
+
+    // Inserts values of the given range in any order, returns amount of inserted elements: values are sorted, their
+    // vertexes are created and linked into a tree in parallel on the executor, and the tree is united with the set,
+    // complexity O(k log k + k log(n / k + 1)) work and O(k + log^2 n) depth
+    template<typename Executor, typename FirstIterator, typename LastIterator>
+    size_t insert_batch(Executor& executor, FirstIterator begin, LastIterator end) {
+        BudgetOf<Executor> budget = RootForkBudget(executor);
+        size_t previous_size = set_size_;
+        std::vector<ValueType> values;
+        for (; begin != end; ++begin) {
+            values.push_back(*begin);
+        }
+        Sort(values.data(), values.data() + values.size(), budget);
+        values.erase(std::unique(values.begin(), values.end(), [](const ValueType& lhs, const ValueType& rhs) {
+            return !(lhs < rhs);
+        }), values.end());
+        std::vector<Node*> vertexes;
+        NewNodes(values, vertexes, budget);
+        Node* batch_root = BuildBalanced(vertexes.data(), vertexes.size(), nullptr, budget);
+        RemoveTombstones();
+        std::vector<Node*> garbage;
+        tree_root_ = Unite(tree_root_, batch_root, garbage, budget);
+        FinishParallelOperation(set_size_ + vertexes.size(), garbage, budget);
+        for (const ValueType& value: values) {
+            AddToFilter(value);
+        }
+        MaintainFilter();
+        return set_size_ - previous_size;
+    }
+
+    // Erases all elements, vertexes are freed in parallel on the executor if the allocator is concurrent and no
+    // memory is retained, complexity O(n) work and O(log n) depth
+    template<typename Executor>
+    void clear(Executor& executor) {
+        ClearLookupCache();
+        BudgetOf<Executor> budget = RootForkBudget(executor);
+        if (!CanFreeConcurrently()) {
+            budget.depth = 0;
+        }
+        Delete(tree_root_, budget);
+        tree_root_ = nullptr;
+        set_size_ = EMPTY_SIZE;
+        tombstones_ = 0;
+        if (membership_filter_ != nullptr) {
+            RebuildFilter();
+        }
+    }
+
+    // Versions of the parallel operations above that run on the default work-stealing pool
+    void unite(Set other) {
+        unite(WorkStealingPool::Default(), std::move(other));
+    }
+
+    void intersect(Set other) {
+        intersect(WorkStealingPool::Default(), std::move(other));
+    }
+
+    void subtract(Set other) {
+        subtract(WorkStealingPool::Default(), std::move(other));
+    }
+
+    template<typename Predicate>
+    size_t erase_if(const Predicate& predicate) {
+        return erase_if(WorkStealingPool::Default(), predicate);
+    }
+
+    template<typename Result, typename Map, typename Reduce>
+    Result map_reduce(const Map& map, const Reduce& reduce, Result identity) const {
+        return map_reduce(WorkStealingPool::Default(), map, reduce, std::move(identity));
+    }
+
+    template<typename Function>
+    void for_each(const Function& function) const {
+        for_each(WorkStealingPool::Default(), function);
+    }
+
+    // Keeps memory of at most the given amount of erased vertexes in the internal free list, so later inserts reuse
+    // it without calling the allocator, 0 disables retention, memory over the limit is released, complexity O(1),
+    // O(k) for the release
+    AA_SET_CONSTEXPR void retain_nodes(size_t limit) {
+        retained_nodes_limit_ = limit;
+        while (retained_nodes_.size() > limit) {
+            NodeTraits::deallocate(node_allocator_, retained_nodes_.back(), 1);
+            retained_nodes_.pop_back();
+        }
+    }
+
+    // Attaches Bloom filter to the set, so find() of most absent values returns end() without walking the tree.
+    // The filter is updated on insert, and rebuilt when the set outgrows it or erased values outnumber the
+    // elements, value type must be hashable with std::hash, complexity O(n)
+    void enable_membership_filter(size_t expected_elements = 0,
+                                  size_t bits_per_element = Filter::DEFAULT_BITS_PER_ELEMENT) {
+        static_assert(IsHashable<ValueType>::value, "Membership filter requires std::hash of the value type");
+        delete membership_filter_;
+        membership_filter_ = new MembershipFilter{Filter(), std::max(expected_elements, set_size_), bits_per_element, 0};
+        RebuildFilter();
+    }
+
+    // Detaches the membership filter, complexity O(1)
+    void disable_membership_filter() {
+        delete membership_filter_;
+        membership_filter_ = nullptr;
+    }
+
+    // Attaches direct-mapped cache of the given amount of slots, rounded up to a power of two, that remembers
+    // vertexes found by find(), so repeated lookups of hot values are answered without walking the tree.
+    // Slots of erased vertexes are invalidated, value type must be hashable with std::hash, complexity O(slots)
+    void enable_lookup_cache(size_t slots = DEFAULT_LOOKUP_CACHE_SLOTS) {
+        static_assert(IsHashable<ValueType>::value, "Lookup cache requires std::hash of the value type");
+        size_t size = 1;
+        while (size < slots) {
+            size *= 2;
+        }
+        AllocateLookupCache(size);
+    }
+
+    // Detaches the lookup cache, complexity O(1)
+    void disable_lookup_cache() {
+        delete lookup_cache_;
+        lookup_cache_ = nullptr;
+    }
+
+    // Moves all vertexes to a single contiguous block in van Emde Boas order of the tree, so every search touches
+    // O(log_B n) cache lines of size B instead of one per level, vertexes inserted later reuse slots of the erased
+    // ones. Can be called at any time between other operations, for example when the set has been churned for a
+    // long time, invalidates all iterators, complexity O(n log log n)
+    void relayout() {
+        if (tree_root_ == nullptr) {
+            return;
+        }
+        std::vector<Node*> order;
+        std::vector<Node*> frontier;
+        order.reserve(set_size_ + tombstones_);
+        LayoutVanEmdeBoas(tree_root_, Height(tree_root_), order, frontier);
+
+        Arena* arena = new Arena{NodeTraits::allocate(node_allocator_, order.size()), order.size(), {}};
+        for (size_t i = 0; i < order.size(); ++i) {
+            Node* vertex = arena->nodes + i;
+            NodeTraits::construct(node_allocator_, vertex, std::move(order[i]->value));
+            vertex->level = order[i]->level;
+            vertex->is_tombstone = order[i]->is_tombstone;
+            vertex->left_son = order[i]->left_son;
+            vertex->right_son = order[i]->right_son;
+        }
+        // the old vertexes point to their new copies with left links until they are freed
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i]->left_son = arena->nodes + i;
+        }
+        for (size_t i = 0; i < order.size(); ++i) {
+            Node* vertex = arena->nodes + i;
+            if (vertex->left_son != nullptr) {
+                vertex->left_son = vertex->left_son->left_son;
+                vertex->left_son->SetParent(vertex);
+            }
+            if (vertex->right_son != nullptr) {
+                vertex->right_son = vertex->right_son->left_son;
+                vertex->right_son->SetParent(vertex);
+            }
+        }
+        for (Node* vertex: order) {
+            FreeNode(vertex);
+        }
+        ClearLookupCache();
+        ReleaseArena();
+        arena_ = arena;
+        tree_root_ = arena->nodes;
+        tree_root_->SetParent(nullptr);
+    }
+
     // If given value is in the set - returns iterator of the element with this value,
     // else - returns end(), complexity O(log n)
-    iterator find(const ValueType& value) const {
-        return iterator(this, Find(tree_root_, value));
+    AA_SET_CONSTEXPR iterator find(const ValueType& value) const {
+        Key key(value);
+        std::atomic<const Node*>* cache_slot = nullptr;
+        if (lookup_cache_ != nullptr) {
+            cache_slot = &lookup_cache_->slots[LookupCacheSlot(value)];
+            const Node* cached = cache_slot->load(std::memory_order_relaxed);
+            if (cached != nullptr && !cached->is_tombstone && Compare(key, cached) == 0) {
+                return iterator(this, cached);
+            }
+        }
+        if (membership_filter_ != nullptr && !membership_filter_->filter.MayContain(value)) {
+            return end();
+        }
+        const Node* vertex = Find(tree_root_, key);
+        if (vertex == nullptr || vertex->is_tombstone) {
+            return end();
+        }
+        if (cache_slot != nullptr) {
+            cache_slot->store(vertex, std::memory_order_relaxed);
+        }
+        return iterator(this, vertex);
     }
 
     // Returns iterator of the element with the smallest value not less, then given,
     // or end() if this element doesn't exist, complexity O(log n)
-    iterator lower_bound(const ValueType& value) const {
-        return iterator(this, LowerBound(tree_root_, value));
+    AA_SET_CONSTEXPR iterator lower_bound(const ValueType& value) const {
+        return iterator(this, SkipTombstones(LowerBound(tree_root_, Key(value))));
+    }
+
+    // Finger search: returns iterator of the element with the smallest value not less, then given, or end() if this
+    // element doesn't exist, climbing from the given iterator only as high as needed before descending,
+    // complexity O(log d) where d is the distance from the finger when the answer lies in a small common subtree,
+    // O(log n) in the worst case, sequence of monotone queries with the previous answer as finger costs amortized
+    // O(1 + log d) per query
+    AA_SET_CONSTEXPR iterator lower_bound(iterator finger, const ValueType& value) const {
+        Key key(value);
+        const Node* fallback = nullptr;
+        const Node* vertex = ClimbFromFinger(finger.current_vertex, key, fallback);
+        return iterator(this, SkipTombstones(LowerBound(vertex, key, fallback)));
+    }
+
+    // Finger search: if given value is in the set - returns iterator of the element with this value, else - returns
+    // end(), climbing from the given iterator only as high as needed before descending, complexity as of
+    // lower_bound(finger, value)
+    AA_SET_CONSTEXPR iterator find(iterator finger, const ValueType& value) const {
+        Key key(value);
+        const Node* fallback = nullptr;
+        const Node* vertex = ClimbFromFinger(finger.current_vertex, key, fallback);
+        vertex = LowerBound(vertex, key, fallback);
+        if (vertex == nullptr || vertex->is_tombstone || Compare(key, vertex) != 0) {
+            return end();
+        }
+        return iterator(this, vertex);
     }
 
     // Returns iterator of the first element of the set, or end() if set is empty(), complexity O(log n)
-    iterator begin() const {
+    AA_SET_CONSTEXPR iterator begin() const {
         Node* t = tree_root_;
         while (t != nullptr && t->left_son != nullptr) {
             t = t->left_son;
         }
-        return iterator(this, t);
+        return iterator(this, SkipTombstones(t));
     }
 
     // Returns iterator of the end of the set, complexity O(1)
-    iterator end() const {
+    AA_SET_CONSTEXPR iterator end() const {
         return iterator(this, nullptr);
     }
 
     // Returns amount of elements the set contains, complexity O(1)
-    size_t size() const {
+    AA_SET_CONSTEXPR size_t size() const {
         return set_size_;
     }
 
     // Returns true if set is empty, or false if it isn't, complexity O(1)
-    bool empty() const {
+    AA_SET_CONSTEXPR bool empty() const {
         return size() == EMPTY_SIZE;
     }
 
-    ~Set() {
+    AA_SET_CONSTEXPR ~Set() {
         Delete(tree_root_);
+        delete membership_filter_;
+        delete lookup_cache_;
+        ReleaseArena();
+        retain_nodes(0);
     }
 
     static constexpr size_t EMPTY_SIZE = 0;
+    static constexpr size_t DEFAULT_LOOKUP_CACHE_SLOTS = 4096;
+    static constexpr size_t PARALLEL_GRAIN = 4096;
 
   private:
-    // Rotates the given vertex to balance level, according to the left son, complexity O(1)
-    Node* Skew(Node* vertex) {
-        if (vertex->left_son == nullptr || vertex->left_son->level != vertex->level) {
-            return vertex;
+    // Returns negative number if the key is less than the value of the vertex, positive if it's greater, or zero if
+    // they are equal, cached key prefixes resolve the comparison without touching the values when they differ,
+    // otherwise values are compared once with operator<=> if it's available, complexity O(1)
+    AA_SET_CONSTEXPR int Compare(const Key& key, const Node* vertex) const {
+        int prefix_order = key.ComparePrefix(*vertex);
+        if (prefix_order != 0) {
+            return prefix_order;
         }
-        Node* s = vertex->left_son;
-        vertex->left_son = s->right_son;
-        if (s->right_son != nullptr) {
-            s->right_son->parent = vertex;
-        }
-        s->right_son = vertex;
-        s->parent = vertex->parent;
-        vertex->parent = s;
-        return s;
+        return ThreeWayCompare(key.value, vertex->value);
     }
 
-    // Rotates the given vertex to balance level, according to the right son, complexity O(1)
-    Node* Split(Node* vertex) {
-        if (vertex->right_son == nullptr || vertex->right_son->right_son == nullptr ||
-            vertex->level != vertex->right_son->right_son->level) {
-            return vertex;
-        }
-        Node* s = vertex->right_son;
-        vertex->right_son = s->left_son;
-        if (s->left_son != nullptr) {
-            s->left_son->parent = vertex;
-        }
-        s->left_son = vertex;
-        s->parent = vertex->parent;
-        vertex->parent = s;
-        ++s->level;
-        return s;
+    // Copies value of the source vertex to the given vertex and exchanges their tombstone marks, so the mark of the
+    // erased element goes with the source vertex that is going to be deleted, complexity O(1)
+    AA_SET_CONSTEXPR void AssignValue(Node* vertex, Node* source) {
+        InvalidateLookupCache(vertex);
+        vertex->value = source->value;
+        static_cast<NodeKeyPrefix<ValueType>&>(*vertex) = *source;
+        size_t is_tombstone = vertex->is_tombstone;
+        vertex->is_tombstone = source->is_tombstone;
+        source->is_tombstone = is_tombstone;
     }
 
-    // Insert value it the AA-tree, returns root of the modified tree and vertex with the given value,
+    // Insert value it the tree, returns root of the modified tree and vertex with the given value,
     // complexity O(log n)
-    Node* Insert(Node* t, const ValueType& value, Node*& inserted_vertex) {
+    AA_SET_CONSTEXPR Node* Insert(Node* t, const Key& key, Node*& inserted_vertex) {
         if (t == nullptr) {
-            inserted_vertex = new Node(value);
+            inserted_vertex = NewNode(key.value);
+            inserted_vertex->level = Balance::LeafRank();
+            AddToFilter(key.value);
             ++set_size_;
             return inserted_vertex;
         }
-        if (value < t->value) {
-            t->left_son = Insert(t->left_son, value, inserted_vertex);
-            t->left_son->parent = t;
-        } else if (t->value < value) {
-            t->right_son = Insert(t->right_son, value, inserted_vertex);
-            t->right_son->parent = t;
+        int order = Compare(key, t);
+        if (order < 0) {
+            t->left_son = Insert(t->left_son, key, inserted_vertex);
+            t->left_son->SetParent(t);
+        } else if (order > 0) {
+            t->right_son = Insert(t->right_son, key, inserted_vertex);
+            t->right_son->SetParent(t);
         } else {
+            if (t->is_tombstone) {
+                t->is_tombstone = false;
+                AddToFilter(t->value);
+                --tombstones_;
+                ++set_size_;
+            }
             inserted_vertex = t;
             return t;
         }
-        t = Skew(t);
-        t = Split(t);
-        return t;
-    }
-
-    // Balances level of given vertex, complexity O(1)
-    void DecreaseLevel(Node* vertex) {
-        size_t expected_level;
-        if (vertex->left_son == nullptr || vertex->right_son == nullptr) {
-            expected_level = 1;
-        } else {
-            expected_level = std::min(vertex->left_son->level, vertex->right_son->level) + 1;
-        }
-        if (vertex->level > expected_level) {
-            vertex->level = expected_level;
-            if (vertex->right_son != nullptr && vertex->right_son->level > expected_level) {
-                vertex->right_son->level = expected_level;
-            }
-        }
+        return Balance::AfterInsert(t);
     }
 
     // Returns son with the first value that is greater than the value of the give vertex, complexity O(log n)
-    const Node* Successor(const Node* vertex) const {
+    template<typename NodePointer>
+    AA_SET_CONSTEXPR NodePointer Successor(NodePointer vertex) const {
         vertex = vertex->right_son;
         while (vertex->left_son != nullptr) {
             vertex = vertex->left_son;
@@ -292,7 +860,8 @@ class Set {
     }
 
     // Returns son with the first value that is less than the value of the give vertex, complexity O(log n)
-    const Node* Predecessor(const Node* vertex) const {
+    template<typename NodePointer>
+    AA_SET_CONSTEXPR NodePointer Predecessor(NodePointer vertex) const {
         vertex = vertex->left_son;
         while (vertex->right_son != nullptr) {
             vertex = vertex->right_son;
@@ -300,110 +869,443 @@ class Set {
         return vertex;
     }
 
-    // Erases value from the AA-tree if it contains it, returns root of the modified tree, complexity O(log n)
-    Node* Erase(Node* vertex, const ValueType& value) {
+    // Erases value from the tree if it contains it, returns root of the modified tree, complexity O(log n)
+    AA_SET_CONSTEXPR Node* Erase(Node* vertex, const Key& key) {
         if (vertex == nullptr) {
             return nullptr;
         }
-        if (value < vertex->value) {
-            vertex->left_son = Erase(vertex->left_son, value);
-        } else if (vertex->value < value) {
-            vertex->right_son = Erase(vertex->right_son, value);
+        int order = Compare(key, vertex);
+        if (order < 0) {
+            vertex->left_son = Erase(vertex->left_son, key);
+        } else if (order > 0) {
+            vertex->right_son = Erase(vertex->right_son, key);
         } else {
             if (vertex->left_son == nullptr && vertex->right_son == nullptr) {
-                delete vertex;
-                --set_size_;
+                if (vertex->is_tombstone) {
+                    --tombstones_;
+                } else {
+                    --set_size_;
+                }
+                DeleteNode(vertex);
                 return nullptr;
             }
             if (vertex->left_son == nullptr) {
-                const Node* s = Successor(vertex);
-                vertex->value = s->value;
-                vertex->right_son = Erase(vertex->right_son, s->value);
+                Node* s = Successor(vertex);
+                AssignValue(vertex, s);
+                vertex->right_son = Erase(vertex->right_son, Key(s->value));
             } else {
-                const Node* s = Predecessor(vertex);
-                vertex->value = s->value;
-                vertex->left_son = Erase(vertex->left_son, s->value);
+                Node* s = Predecessor(vertex);
+                AssignValue(vertex, s);
+                vertex->left_son = Erase(vertex->left_son, Key(s->value));
             }
         }
-        DecreaseLevel(vertex);
+        return Balance::AfterErase(vertex);
+    }
+
+    // Returns vertex with the first value that is greater than the value of the given vertex, climbs by parent
+    // links or descends from the root without them, complexity O(log n)
+    AA_SET_CONSTEXPR const Node* Next(const Node* vertex) const {
         if (vertex->right_son != nullptr) {
-            vertex->right_son = Skew(vertex->right_son);
-            if (vertex->right_son->right_son != nullptr) {
-                vertex->right_son->right_son = Skew(vertex->right_son->right_son);
+            return Successor(vertex);
+        }
+        if (!HasParentLinks) {
+            const Node* ans = nullptr;
+            Key key(vertex->value);
+            for (const Node* t = tree_root_; t != vertex;) {
+                if (Compare(key, t) < 0) {
+                    ans = t;
+                    t = t->left_son;
+                } else {
+                    t = t->right_son;
+                }
             }
+            return ans;
         }
-        vertex = Split(vertex);
-        if (vertex->right_son != nullptr) {
-            vertex->right_son = Split(vertex->right_son);
+        while (vertex->Parent() != nullptr && vertex->Parent()->left_son != vertex) {
+            vertex = vertex->Parent();
+        }
+        return vertex->Parent();
+    }
+
+    // Returns vertex with the first value that is less than the value of the given vertex, climbs by parent links
+    // or descends from the root without them, complexity O(log n)
+    AA_SET_CONSTEXPR const Node* Prev(const Node* vertex) const {
+        if (vertex->left_son != nullptr) {
+            return Predecessor(vertex);
+        }
+        if (!HasParentLinks) {
+            const Node* ans = nullptr;
+            Key key(vertex->value);
+            for (const Node* t = tree_root_; t != vertex;) {
+                if (Compare(key, t) > 0) {
+                    ans = t;
+                    t = t->right_son;
+                } else {
+                    t = t->left_son;
+                }
+            }
+            return ans;
+        }
+        while (vertex->Parent() != nullptr && vertex->Parent()->right_son != vertex) {
+            vertex = vertex->Parent();
+        }
+        return vertex->Parent();
+    }
+
+    // Returns slot of the lookup cache for the given value, complexity O(1)
+    size_t LookupCacheSlot(const ValueType& value) const {
+        return MixHash(static_cast<uint64_t>(FilterHash<ValueType>()(value))) & lookup_cache_->mask;
+    }
+
+    // Removes the vertex from the lookup cache, must be called before its value changes or it's deleted,
+    // complexity O(1)
+    AA_SET_CONSTEXPR void InvalidateLookupCache(const Node* vertex) {
+        if (lookup_cache_ != nullptr) {
+            std::atomic<const Node*>& cache_slot = lookup_cache_->slots[LookupCacheSlot(vertex->value)];
+            if (cache_slot.load(std::memory_order_relaxed) == vertex) {
+                cache_slot.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Replaces the lookup cache with an empty one of the given amount of slots, which must be a power of two.
+    // Copies of the set call it directly, so copying doesn't require hashable values, complexity O(slots)
+    void AllocateLookupCache(size_t slots) {
+        delete lookup_cache_;
+        lookup_cache_ = new LookupCache(slots);
+    }
+
+    // Empties all slots of the lookup cache, complexity O(slots)
+    AA_SET_CONSTEXPR void ClearLookupCache() {
+        if (lookup_cache_ != nullptr) {
+            for (std::atomic<const Node*>& cache_slot: lookup_cache_->slots) {
+                cache_slot.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Creates vertex with the given value, in a free slot of the arena if there is one, otherwise in the retained
+    // memory or in the memory of the allocator, complexity O(1)
+    AA_SET_CONSTEXPR Node* NewNode(const ValueType& value) {
+        std::vector<Node*>* free_list = nullptr;
+        if (arena_ != nullptr && !arena_->free_slots.empty()) {
+            free_list = &arena_->free_slots;
+        } else if (!retained_nodes_.empty()) {
+            free_list = &retained_nodes_;
+        }
+        if (free_list != nullptr) {
+            Node* slot = free_list->back();
+            NodeTraits::construct(node_allocator_, slot, value);
+            free_list->pop_back();
+            return slot;
+        }
+        return AllocateNode(value);
+    }
+
+    // Creates vertex with the given value in the memory of the allocator, complexity O(1)
+    AA_SET_CONSTEXPR Node* AllocateNode(const ValueType& value) {
+        Node* vertex = NodeTraits::allocate(node_allocator_, 1);
+        try {
+            NodeTraits::construct(node_allocator_, vertex, value);
+        } catch (...) {
+            NodeTraits::deallocate(node_allocator_, vertex, 1);
+            throw;
         }
         return vertex;
     }
 
-    // Returns vertex with the first value that is greater than the value of the given vertex, complexity O(log n)
-    const Node* Next(const Node* vertex) const {
-        if (vertex->right_son != nullptr) {
-            return Successor(vertex);
+    // Destroys vertex, returning its slot to the arena if it was placed there, otherwise keeping its memory if the
+    // retention limit allows, complexity O(1)
+    AA_SET_CONSTEXPR void FreeNode(Node* vertex) {
+        NodeTraits::destroy(node_allocator_, vertex);
+        if (arena_ != nullptr && !std::less<const Node*>()(vertex, arena_->nodes) &&
+            std::less<const Node*>()(vertex, arena_->nodes + arena_->capacity)) {
+            arena_->free_slots.push_back(vertex);
+            return;
         }
-        while (vertex->parent != nullptr && vertex->parent->left_son != vertex) {
-            vertex = vertex->parent;
+        if (retained_nodes_.size() < retained_nodes_limit_) {
+            retained_nodes_.push_back(vertex);
+            return;
         }
-        return vertex->parent;
+        NodeTraits::deallocate(node_allocator_, vertex, 1);
     }
 
-    // Returns vertex with the first value that is less than the value of the given vertex, complexity O(log n)
-    const Node* Prev(const Node* vertex) const {
-        if (vertex->left_son != nullptr) {
-            return Predecessor(vertex);
+    // Deletes vertex that was unlinked from the tree, complexity O(1)
+    AA_SET_CONSTEXPR void DeleteNode(Node* vertex) {
+        InvalidateLookupCache(vertex);
+        FreeNode(vertex);
+    }
+
+    // Frees the arena, all its slots must be free, complexity O(1)
+    AA_SET_CONSTEXPR void ReleaseArena() {
+        if (arena_ != nullptr) {
+            NodeTraits::deallocate(node_allocator_, arena_->nodes, arena_->capacity);
+            delete arena_;
+            arena_ = nullptr;
         }
-        while (vertex->parent != nullptr && vertex->parent->right_son != vertex) {
-            vertex = vertex->parent;
+    }
+
+    // Returns amount of levels of the subtree of the given vertex, complexity O(k)
+    static size_t Height(const Node* vertex) {
+        if (vertex == nullptr) {
+            return 0;
+        }
+        return std::max(Height(vertex->left_son), Height(vertex->right_son)) + 1;
+    }
+
+    // Appends vertexes of the subtree of the given vertex cut after the given amount of levels to the order in
+    // van Emde Boas layout: the top half of the levels first, then every subtree hanging below it, recursively.
+    // Sons of the vertexes at the cut are appended to the frontier, complexity O(k log log k)
+    static void LayoutVanEmdeBoas(Node* vertex, size_t height, std::vector<Node*>& order,
+                                  std::vector<Node*>& frontier) {
+        if (height <= 1) {
+            order.push_back(vertex);
+            if (vertex->left_son != nullptr) {
+                frontier.push_back(vertex->left_son);
+            }
+            if (vertex->right_son != nullptr) {
+                frontier.push_back(vertex->right_son);
+            }
+            return;
+        }
+        size_t top_height = height / 2;
+        std::vector<Node*> top_frontier;
+        LayoutVanEmdeBoas(vertex, top_height, order, top_frontier);
+        for (Node* subtree_root: top_frontier) {
+            LayoutVanEmdeBoas(subtree_root, height - top_height, order, frontier);
+        }
+    }
+
+    // Adds value to the membership filter if it's enabled, complexity O(1)
+    AA_SET_CONSTEXPR void AddToFilter(const ValueType& value) {
+        if (membership_filter_ != nullptr) {
+            membership_filter_->filter.Add(value);
+        }
+    }
+
+    // Counts erased values that stay in the membership filter, rebuilds it when needed, complexity O(1), amortized
+    // O(1) for the rebuild
+    AA_SET_CONSTEXPR void NoteFilterErases(size_t count) {
+        if (membership_filter_ != nullptr) {
+            membership_filter_->stale_erases += count;
+            MaintainFilter();
         }
-        return vertex->parent;
     }
 
-    // Returns root of the copied version of the tree with the given root, complexity O(n)
-    Node* Copy(Node* vertex) {
+    // Rebuilds the membership filter if the set outgrew it or erased values outnumber the elements,
+    // complexity O(1), amortized O(1) for the rebuild
+    AA_SET_CONSTEXPR void MaintainFilter() {
+        if (membership_filter_ != nullptr && (set_size_ > membership_filter_->capacity ||
+                                              membership_filter_->stale_erases > set_size_)) {
+            membership_filter_->capacity = std::max(membership_filter_->capacity, 2 * set_size_);
+            RebuildFilter();
+        }
+    }
+
+    // Fills the membership filter with the elements of the set from scratch, complexity O(n)
+    void RebuildFilter() {
+        membership_filter_->filter = Filter(membership_filter_->capacity, membership_filter_->bits_per_element);
+        membership_filter_->stale_erases = 0;
+        for (const ValueType& value: *this) {
+            membership_filter_->filter.Add(value);
+        }
+    }
+
+    // Returns sorted values of the given range without duplicates, complexity O(k log k)
+    template<typename FirstIterator, typename LastIterator>
+    static AA_SET_CONSTEXPR std::vector<ValueType> SortedUnique(FirstIterator begin, LastIterator end) {
+        std::vector<ValueType> values;
+        for (; begin != end; ++begin) {
+            values.push_back(*begin);
+        }
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end(), [](const ValueType& lhs, const ValueType& rhs) {
+            return !(lhs < rhs);
+        }), values.end());
+        return values;
+    }
+
+    // Returns upper estimate of the height of the tree, log2(n + 1) + 1, complexity O(log n)
+    AA_SET_CONSTEXPR size_t TreeHeight() const {
+        size_t height = 1;
+        for (size_t vertexes = set_size_ + tombstones_ + 1; vertexes > 1; vertexes /= 2) {
+            ++height;
+        }
+        return height;
+    }
+
+    // Returns the given vertex if it isn't a tombstone, otherwise the first vertex after it that isn't a tombstone,
+    // or nullptr if it doesn't exist, complexity O(1) without tombstones
+    AA_SET_CONSTEXPR const Node* SkipTombstones(const Node* vertex) const {
+        while (tombstones_ != 0 && vertex != nullptr && vertex->is_tombstone) {
+            vertex = Next(vertex);
+        }
+        return vertex;
+    }
+
+    // Returns the given vertex if it isn't a tombstone, otherwise the last vertex before it that isn't a tombstone,
+    // or nullptr if it doesn't exist, complexity O(1) without tombstones
+    AA_SET_CONSTEXPR const Node* SkipTombstonesBackward(const Node* vertex) const {
+        while (tombstones_ != 0 && vertex != nullptr && vertex->is_tombstone) {
+            vertex = Prev(vertex);
+        }
+        return vertex;
+    }
+
+    // Appends vertexes of the tree with the given root that aren't tombstones to the given vector in order of
+    // values and deletes the tombstones, complexity O(n)
+    AA_SET_CONSTEXPR void TakeAliveVertexes(Node* vertex, std::vector<Node*>& vertexes) {
         if (vertex == nullptr) {
+            return;
+        }
+        TakeAliveVertexes(vertex->left_son, vertexes);
+        Node* right_son = vertex->right_son;
+        if (vertex->is_tombstone) {
+            DeleteNode(vertex);
+        } else {
+            vertexes.push_back(vertex);
+        }
+        TakeAliveVertexes(right_son, vertexes);
+    }
+
+    // Links the given vertexes sorted by value into perfectly balanced tree and returns its root: the left subtree
+    // of every vertex is not greater than the right one, and every vertex gets the rank the balancing policy gives
+    // to such trees, or into Cartesian tree if the policy has random ranks, complexity O(n)
+    AA_SET_CONSTEXPR Node* BuildBalanced(Node* const* vertexes, size_t count, Node* parent) {
+        if (Balance::HAS_RANDOM_RANKS) {
+            return BuildCartesian(vertexes, count, parent);
+        }
+        if (count == 0) {
+            return nullptr;
+        }
+        size_t middle = (count - 1) / 2;
+        Node* vertex = vertexes[middle];
+        vertex->SetParent(parent);
+        vertex->left_son = BuildBalanced(vertexes, middle, vertex);
+        vertex->right_son = BuildBalanced(vertexes + middle + 1, count - middle - 1, vertex);
+        vertex->level = Balance::BalancedRank(RankOf(vertex->left_son), RankOf(vertex->right_son));
+        return vertex;
+    }
+
+    // Links the given vertexes sorted by value into Cartesian tree over fresh ranks of the balancing policy and
+    // returns its root: vertexes are appended to the right spine, which keeps the vertexes with ranks not less than
+    // the rank of the appended one, so the popped ones become its left subtree, complexity O(n)
+    AA_SET_CONSTEXPR Node* BuildCartesian(Node* const* vertexes, size_t count, Node* parent) {
+        std::vector<Node*> spine;
+        for (size_t i = 0; i < count; ++i) {
+            Node* vertex = vertexes[i];
+            vertex->level = Balance::LeafRank();
+            Node* left_son = nullptr;
+            while (!spine.empty() && spine.back()->level < vertex->level) {
+                left_son = spine.back();
+                spine.pop_back();
+            }
+            vertex->left_son = left_son;
+            vertex->right_son = nullptr;
+            if (left_son != nullptr) {
+                left_son->SetParent(vertex);
+            }
+            if (!spine.empty()) {
+                spine.back()->right_son = vertex;
+                vertex->SetParent(spine.back());
+            }
+            spine.push_back(vertex);
+        }
+        if (spine.empty()) {
             return nullptr;
         }
-        Node* copied_vertex = new Node(vertex->value);
+        spine.front()->SetParent(parent);
+        return spine.front();
+    }
+
+    // Appends vertexes of the tree with the given root to the given vector in preorder, complexity O(n)
+    static AA_SET_CONSTEXPR void TakeVertexes(Node* vertex, std::vector<Node*>& vertexes) {
+        if (vertex != nullptr) {
+            vertexes.push_back(vertex);
+            TakeVertexes(vertex->left_son, vertexes);
+            TakeVertexes(vertex->right_son, vertexes);
+        }
+    }
+
+    // Returns root of the copied version of the tree with the given root, takes vertexes from the back of the
+    // recycled ones and overwrites their values while there are any, so the values reuse their own memory,
+    // and allocates the rest, complexity O(n)
+    AA_SET_CONSTEXPR Node* Copy(Node* vertex, std::vector<Node*>& recycled) {
+        if (vertex == nullptr) {
+            return nullptr;
+        }
+        Node* copied_vertex = nullptr;
+        if (recycled.empty()) {
+            copied_vertex = NewNode(vertex->value);
+        } else {
+            copied_vertex = recycled.back();
+            recycled.pop_back();
+            copied_vertex->value = vertex->value;
+            copied_vertex->SetPrefix(copied_vertex->value);
+            copied_vertex->SetParent(nullptr);
+        }
         copied_vertex->level = vertex->level;
-        copied_vertex->left_son = Copy(vertex->left_son);
-        copied_vertex->right_son = Copy(vertex->right_son);
+        copied_vertex->is_tombstone = vertex->is_tombstone;
+        copied_vertex->left_son = Copy(vertex->left_son, recycled);
+        copied_vertex->right_son = Copy(vertex->right_son, recycled);
         if (copied_vertex->left_son != nullptr) {
-            copied_vertex->left_son->parent = copied_vertex;
+            copied_vertex->left_son->SetParent(copied_vertex);
         }
         if (copied_vertex->right_son != nullptr) {
-            copied_vertex->right_son->parent = copied_vertex;
+            copied_vertex->right_son->SetParent(copied_vertex);
         }
         return copied_vertex;
     }
 
+    // Climbs from the finger vertex to the root of the smallest subtree that contains either the vertex with the
+    // key or the place it would be inserted at, sets fallback to the vertex following this subtree when the lower
+    // bound of the key may follow it, or to nullptr. Returns the root if the finger is nullptr or the set doesn't
+    // keep parent links, complexity O(log d)
+    AA_SET_CONSTEXPR const Node* ClimbFromFinger(const Node* vertex, const Key& key, const Node*& fallback) const {
+        fallback = nullptr;
+        if (vertex == nullptr || !HasParentLinks) {
+            return tree_root_;
+        }
+        if (Compare(key, vertex) <= 0) {
+            while (vertex->Parent() != nullptr &&
+                   (vertex->Parent()->right_son != vertex || Compare(key, vertex->Parent()) <= 0)) {
+                vertex = vertex->Parent();
+            }
+            return vertex;
+        }
+        while (vertex->Parent() != nullptr &&
+               (vertex->Parent()->left_son != vertex || Compare(key, vertex->Parent()) > 0)) {
+            vertex = vertex->Parent();
+        }
+        fallback = vertex->Parent();
+        return vertex;
+    }
+
     // Returns vertex with the given value if tree with the given root contains it, or nullptr if it isn't,
     // complexity O(log n)
-    const Node* Find(const Node* vertex, const ValueType& value) const {
-        const Node* ans = nullptr;
+    AA_SET_CONSTEXPR const Node* Find(const Node* vertex, const Key& key) const {
         while (vertex != nullptr) {
-            if (value < vertex->value) {
+            int order = Compare(key, vertex);
+            if (order < 0) {
                 vertex = vertex->left_son;
-            } else if (vertex->value < value) {
+            } else if (order > 0) {
                 vertex = vertex->right_son;
             } else {
                 return vertex;
             }
         }
-        return ans;
+        return nullptr;
     }
 
     // Returns vertex in the tree with the given root with the first value that is not less than the given value,
-    // or nullptr if given tree doesn't contain it, complexity O(log n)
-    const Node* LowerBound(const Node* vertex, const ValueType& value) const {
-        const Node* ans = nullptr;
+    // or the given fallback vertex if given tree doesn't contain it, complexity O(log n)
+    AA_SET_CONSTEXPR const Node* LowerBound(const Node* vertex, const Key& key, const Node* ans = nullptr) const {
         while (vertex != nullptr) {
-            if (value < vertex->value) {
+            int order = Compare(key, vertex);
+            if (order < 0) {
                 ans = vertex;
                 vertex = vertex->left_son;
-            } else if (vertex->value < value) {
+            } else if (order > 0) {
                 vertex = vertex->right_son;
             } else {
                 return vertex;
@@ -412,15 +1314,457 @@ class Set {
         return ans;
     }
 
+    // Trees of the values of a tree that are less and greater than a value, and the vertex with the value if the
+    // tree contains it, its sons are stale
+    struct SplitTrees {
+        Node* less;
+        Node* equal;
+        Node* greater;
+    };
+
+    // Splits the tree with the given root by the given value with joins along the search path,
+    // complexity O(log n)
+    SplitTrees Split(Node* vertex, const Key& key) const {
+        if (vertex == nullptr) {
+            return SplitTrees{nullptr, nullptr, nullptr};
+        }
+        int order = Compare(key, vertex);
+        if (order == 0) {
+            return SplitTrees{vertex->left_son, vertex, vertex->right_son};
+        }
+        if (order < 0) {
+            SplitTrees trees = Split(vertex->left_son, key);
+            trees.greater = Balance::Join(trees.greater, vertex, vertex->right_son);
+            return trees;
+        }
+        SplitTrees trees = Split(vertex->right_son, key);
+        trees.less = Balance::Join(vertex->left_son, vertex, trees.less);
+        return trees;
+    }
+
+    // Cuts the vertex with the greatest value out of the tree with the given root, returns root of the rest,
+    // complexity O(log n)
+    Node* SplitLast(Node* vertex, Node*& last) const {
+        if (vertex->right_son == nullptr) {
+            last = vertex;
+            return vertex->left_son;
+        }
+        Node* rest = SplitLast(vertex->right_son, last);
+        return Balance::Join(vertex->left_son, vertex, rest);
+    }
+
+    // Links two trees, values of the left one must be less than values of the right one, complexity O(log n)
+    Node* JoinTrees(Node* left, Node* right) const {
+        if (left == nullptr) {
+            return right;
+        }
+        Node* last = nullptr;
+        Node* rest = SplitLast(left, last);
+        return Balance::Join(rest, last, right);
+    }
+
+    // Executor of a parallel operation and the depth of the recursion down to which it's forked
+    template<typename Executor>
+    struct ForkBudget {
+        Executor* executor;
+        size_t depth;
+    };
+
+    // Budget of an operation given the executor or the execution policy it was called with
+    template<typename Executor>
+    using BudgetOf = ForkBudget<typename ExecutorOf<Executor>::Type>;
+
+    // Returns budget of an operation that forks to about 8 tasks per thread of the executor, complexity O(1)
+    template<typename Executor>
+    static BudgetOf<Executor> RootForkBudget(Executor& executor) {
+        typename ExecutorOf<Executor>::Type& runner = ExecutorOf<Executor>::Get(executor);
+        size_t depth = 0;
+        for (size_t tasks = 8 * runner.thread_count(); tasks > 1 && runner.thread_count() > 1; tasks /= 2) {
+            ++depth;
+        }
+        return BudgetOf<Executor>{&runner, depth};
+    }
+
+    // Runs both functions with the budget of the next level of the recursion, in parallel while the budget allows
+    template<typename Executor, typename Left, typename Right>
+    static void Fork(ForkBudget<Executor> budget, const Left& left, const Right& right) {
+        if (budget.depth == 0) {
+            left(budget);
+            right(budget);
+            return;
+        }
+        ForkBudget<Executor> next{budget.executor, budget.depth - 1};
+        budget.executor->Invoke([&left, next] {
+            left(next);
+        }, [&right, next] {
+            right(next);
+        });
+    }
+
+    // Returns the budget for a range of the given size, ranges of less than PARALLEL_GRAIN elements aren't forked
+    template<typename Executor>
+    static ForkBudget<Executor> RangeForkBudget(ForkBudget<Executor> budget, size_t count) {
+        if (count < PARALLEL_GRAIN) {
+            budget.depth = 0;
+        }
+        return budget;
+    }
+
+    // Returns root of the union of the trees, vertexes of the right tree with values of the left one are appended to
+    // the garbage, complexity O(m log(n / m + 1))
+    template<typename Executor>
+    Node* Unite(Node* left, Node* right, std::vector<Node*>& garbage, ForkBudget<Executor> budget) const {
+        if (left == nullptr) {
+            return right;
+        }
+        if (right == nullptr) {
+            return left;
+        }
+        SplitTrees trees = Split(right, Key(left->value));
+        if (trees.equal != nullptr) {
+            garbage.push_back(trees.equal);
+        }
+        Node* less = left->left_son;
+        Node* greater = left->right_son;
+        std::vector<Node*> greater_garbage;
+        Fork(budget, [&](ForkBudget<Executor> next) {
+            less = Unite(less, trees.less, garbage, next);
+        }, [&](ForkBudget<Executor> next) {
+            greater = Unite(greater, trees.greater, greater_garbage, next);
+        });
+        garbage.insert(garbage.end(), greater_garbage.begin(), greater_garbage.end());
+        return Balance::Join(less, left, greater);
+    }
+
+    // Returns root of the intersection of the trees, other vertexes are appended to the garbage,
+    // complexity O(m log(n / m + 1))
+    template<typename Executor>
+    Node* Intersect(Node* left, Node* right, std::vector<Node*>& garbage, ForkBudget<Executor> budget) const {
+        if (left == nullptr || right == nullptr) {
+            TakeVertexes(left, garbage);
+            TakeVertexes(right, garbage);
+            return nullptr;
+        }
+        SplitTrees trees = Split(right, Key(left->value));
+        Node* less = left->left_son;
+        Node* greater = left->right_son;
+        std::vector<Node*> greater_garbage;
+        Fork(budget, [&](ForkBudget<Executor> next) {
+            less = Intersect(less, trees.less, garbage, next);
+        }, [&](ForkBudget<Executor> next) {
+            greater = Intersect(greater, trees.greater, greater_garbage, next);
+        });
+        garbage.insert(garbage.end(), greater_garbage.begin(), greater_garbage.end());
+        if (trees.equal == nullptr) {
+            garbage.push_back(left);
+            return JoinTrees(less, greater);
+        }
+        garbage.push_back(trees.equal);
+        return Balance::Join(less, left, greater);
+    }
+
+    // Returns root of the difference of the trees, other vertexes are appended to the garbage,
+    // complexity O(m log(n / m + 1))
+    template<typename Executor>
+    Node* Subtract(Node* left, Node* right, std::vector<Node*>& garbage, ForkBudget<Executor> budget) const {
+        if (left == nullptr || right == nullptr) {
+            TakeVertexes(right, garbage);
+            return left;
+        }
+        SplitTrees trees = Split(right, Key(left->value));
+        Node* less = left->left_son;
+        Node* greater = left->right_son;
+        std::vector<Node*> greater_garbage;
+        Fork(budget, [&](ForkBudget<Executor> next) {
+            less = Subtract(less, trees.less, garbage, next);
+        }, [&](ForkBudget<Executor> next) {
+            greater = Subtract(greater, trees.greater, greater_garbage, next);
+        });
+        garbage.insert(garbage.end(), greater_garbage.begin(), greater_garbage.end());
+        if (trees.equal != nullptr) {
+            garbage.push_back(trees.equal);
+            garbage.push_back(left);
+            return JoinTrees(less, greater);
+        }
+        return Balance::Join(less, left, greater);
+    }
+
+    // Returns root of the tree without vertexes whose values satisfy the predicate, they are appended to the
+    // garbage, complexity O(n)
+    template<typename Executor, typename Predicate>
+    Node* EraseIf(Node* vertex, const Predicate& predicate, std::vector<Node*>& garbage,
+                  ForkBudget<Executor> budget) const {
+        if (vertex == nullptr) {
+            return nullptr;
+        }
+        Node* less = vertex->left_son;
+        Node* greater = vertex->right_son;
+        std::vector<Node*> greater_garbage;
+        Fork(budget, [&](ForkBudget<Executor> next) {
+            less = EraseIf(less, predicate, garbage, next);
+        }, [&](ForkBudget<Executor> next) {
+            greater = EraseIf(greater, predicate, greater_garbage, next);
+        });
+        garbage.insert(garbage.end(), greater_garbage.begin(), greater_garbage.end());
+        if (predicate(static_cast<const ValueType&>(vertex->value))) {
+            garbage.push_back(vertex);
+            return JoinTrees(less, greater);
+        }
+        return Balance::Join(less, vertex, greater);
+    }
+
+    // Returns reduce of map of the values of the tree that aren't tombstones, complexity O(n)
+    template<typename Executor, typename Result, typename Map, typename Reduce>
+    static Result MapReduce(const Node* vertex, const Map& map, const Reduce& reduce, const Result& identity,
+                            ForkBudget<Executor> budget) {
+        if (vertex == nullptr) {
+            return identity;
+        }
+        Result less = identity;
+        Result greater = identity;
+        Fork(budget, [&](ForkBudget<Executor> next) {
+            less = MapReduce(vertex->left_son, map, reduce, identity, next);
+        }, [&](ForkBudget<Executor> next) {
+            greater = MapReduce(vertex->right_son, map, reduce, identity, next);
+        });
+        if (!vertex->is_tombstone) {
+            less = reduce(std::move(less), map(vertex->value));
+        }
+        return reduce(std::move(less), std::move(greater));
+    }
+
+    // Calls the function for the values of the tree that aren't tombstones, complexity O(n)
+    template<typename Executor, typename Function>
+    static void ForEach(const Node* vertex, const Function& function, ForkBudget<Executor> budget) {
+        if (vertex == nullptr) {
+            return;
+        }
+        Fork(budget, [&](ForkBudget<Executor> next) {
+            ForEach(vertex->left_son, function, next);
+            if (!vertex->is_tombstone) {
+                function(vertex->value);
+            }
+        }, [&](ForkBudget<Executor> next) {
+            ForEach(vertex->right_son, function, next);
+        });
+    }
+
+    // Sorts the given values, sorts halves in parallel and merges them, complexity O(k log k)
+    template<typename Executor>
+    static void Sort(ValueType* begin, ValueType* end, ForkBudget<Executor> budget) {
+        budget = RangeForkBudget(budget, static_cast<size_t>(end - begin));
+        if (budget.depth == 0) {
+            std::sort(begin, end);
+            return;
+        }
+        ValueType* middle = begin + (end - begin) / 2;
+        Fork(budget, [&](ForkBudget<Executor> next) {
+            Sort(begin, middle, next);
+        }, [&](ForkBudget<Executor> next) {
+            Sort(middle, end, next);
+        });
+        std::inplace_merge(begin, middle, end);
+    }
+
+    // Returns true if vertexes may be created from several threads: the allocator is concurrent, and there is no
+    // memory of erased vertexes to reuse, complexity O(1)
+    bool CanAllocateConcurrently() const {
+        return IsConcurrentAllocator<Allocator>::value && retained_nodes_.empty() &&
+               (arena_ == nullptr || arena_->free_slots.empty());
+    }
+
+    // Returns true if vertexes may be freed from several threads: the allocator is concurrent, and their memory
+    // isn't retained or returned to the arena, complexity O(1)
+    bool CanFreeConcurrently() const {
+        return IsConcurrentAllocator<Allocator>::value && retained_nodes_limit_ == 0 && arena_ == nullptr;
+    }
+
+    // Creates vertexes with the given values, in parallel if the allocator allows it, frees all of them if one
+    // can't be created, complexity O(k)
+    template<typename Executor>
+    void NewNodes(const std::vector<ValueType>& values, std::vector<Node*>& vertexes, ForkBudget<Executor> budget) {
+        vertexes.assign(values.size(), nullptr);
+        try {
+            if (CanAllocateConcurrently()) {
+                AllocateNodes(values.data(), vertexes.data(), values.size(), budget);
+            } else {
+                for (size_t i = 0; i < values.size(); ++i) {
+                    vertexes[i] = NewNode(values[i]);
+                }
+            }
+        } catch (...) {
+            for (Node* vertex: vertexes) {
+                if (vertex != nullptr) {
+                    FreeNode(vertex);
+                }
+            }
+            throw;
+        }
+    }
+
+    template<typename Executor>
+    void AllocateNodes(const ValueType* values, Node** vertexes, size_t count, ForkBudget<Executor> budget) {
+        budget = RangeForkBudget(budget, count);
+        if (budget.depth == 0) {
+            for (size_t i = 0; i < count; ++i) {
+                vertexes[i] = AllocateNode(values[i]);
+            }
+            return;
+        }
+        size_t middle = count / 2;
+        Fork(budget, [&](ForkBudget<Executor> next) {
+            AllocateNodes(values, vertexes, middle, next);
+        }, [&](ForkBudget<Executor> next) {
+            AllocateNodes(values + middle, vertexes + middle, count - middle, next);
+        });
+    }
+
+    // Links the given vertexes sorted by value into perfectly balanced tree like the sequential version, links both
+    // subtrees of every vertex in parallel, Cartesian trees are linked sequentially, complexity O(n)
+    template<typename Executor>
+    Node* BuildBalanced(Node* const* vertexes, size_t count, Node* parent, ForkBudget<Executor> budget) {
+        budget = RangeForkBudget(budget, count);
+        if (budget.depth == 0 || Balance::HAS_RANDOM_RANKS) {
+            return BuildBalanced(vertexes, count, parent);
+        }
+        size_t middle = (count - 1) / 2;
+        Node* vertex = vertexes[middle];
+        vertex->SetParent(parent);
+        Fork(budget, [&](ForkBudget<Executor> next) {
+            vertex->left_son = BuildBalanced(vertexes, middle, vertex, next);
+        }, [&](ForkBudget<Executor> next) {
+            vertex->right_son = BuildBalanced(vertexes + middle + 1, count - middle - 1, vertex, next);
+        });
+        vertex->level = Balance::BalancedRank(RankOf(vertex->left_son), RankOf(vertex->right_son));
+        return vertex;
+    }
+
+    // Returns root of the copied version of the tree with the given root, copies both subtrees of every vertex in
+    // parallel, the allocator must be concurrent, complexity O(n)
+    template<typename Executor>
+    Node* Copy(const Node* vertex, ForkBudget<Executor> budget) {
+        if (vertex == nullptr) {
+            return nullptr;
+        }
+        if (budget.depth == 0) {
+            std::vector<Node*> recycled;
+            return Copy(const_cast<Node*>(vertex), recycled);
+        }
+        Node* copied_vertex = AllocateNode(vertex->value);
+        copied_vertex->level = vertex->level;
+        copied_vertex->is_tombstone = vertex->is_tombstone;
+        Fork(budget, [&](ForkBudget<Executor> next) {
+            copied_vertex->left_son = Copy(vertex->left_son, next);
+        }, [&](ForkBudget<Executor> next) {
+            copied_vertex->right_son = Copy(vertex->right_son, next);
+        });
+        if (copied_vertex->left_son != nullptr) {
+            copied_vertex->left_son->SetParent(copied_vertex);
+        }
+        if (copied_vertex->right_son != nullptr) {
+            copied_vertex->right_son->SetParent(copied_vertex);
+        }
+        return copied_vertex;
+    }
+
+    // Deletes all vertexes of the tree with the given root, both subtrees of every vertex in parallel while the
+    // budget allows, which requires a concurrent allocator, complexity O(n)
+    template<typename Executor>
+    void Delete(Node* vertex, ForkBudget<Executor> budget) {
+        if (vertex == nullptr) {
+            return;
+        }
+        if (budget.depth == 0) {
+            Delete(vertex);
+            return;
+        }
+        Fork(budget, [&](ForkBudget<Executor> next) {
+            Delete(vertex->left_son, next);
+        }, [&](ForkBudget<Executor> next) {
+            Delete(vertex->right_son, next);
+        });
+        FreeNode(vertex);
+    }
+
+    // Frees the given vertexes, in parallel if the allocator allows it, complexity O(k)
+    template<typename Executor>
+    void FreeNodes(Node* const* vertexes, size_t count, ForkBudget<Executor> budget) {
+        budget = RangeForkBudget(budget, count);
+        if (budget.depth == 0 || !CanFreeConcurrently()) {
+            for (size_t i = 0; i < count; ++i) {
+                FreeNode(vertexes[i]);
+            }
+            return;
+        }
+        size_t middle = count / 2;
+        Fork(budget, [&](ForkBudget<Executor> next) {
+            FreeNodes(vertexes, middle, next);
+        }, [&](ForkBudget<Executor> next) {
+            FreeNodes(vertexes + middle, count - middle, next);
+        });
+    }
+
+    // Removes tombstones without rebuilding the membership filter, complexity O(n), O(1) without tombstones
+    AA_SET_CONSTEXPR void RemoveTombstones() {
+        if (tombstones_ == 0) {
+            return;
+        }
+        std::vector<Node*> vertexes;
+        vertexes.reserve(set_size_);
+        TakeAliveVertexes(tree_root_, vertexes);
+        tombstones_ = 0;
+        tree_root_ = BuildBalanced(vertexes.data(), vertexes.size(), nullptr);
+    }
+
+    // Takes the tree of the given set for a parallel operation with this one and returns its root, the elements of
+    // the set are copied to new vertexes if its vertexes can't be freed by this set, tombstones of both sets are
+    // removed, complexity O(1) for the moved vertexes, O(k) otherwise
+    Node* TakeTree(Set& other, size_t& other_size) {
+        RemoveTombstones();
+        other.RemoveTombstones();
+        Node* root = nullptr;
+        if (other.arena_ != nullptr || !(other.node_allocator_ == node_allocator_)) {
+            std::vector<Node*> vertexes;
+            vertexes.reserve(other.set_size_);
+            for (const ValueType& value: other) {
+                vertexes.push_back(NewNode(value));
+            }
+            root = BuildBalanced(vertexes.data(), vertexes.size(), nullptr);
+            other_size = vertexes.size();
+        } else {
+            std::swap(root, other.tree_root_);
+            std::swap(other_size, other.set_size_);
+        }
+        return root;
+    }
+
+    // Frees the garbage of a parallel operation over vertexes of the given total amount, complexity O(k)
+    template<typename Executor>
+    void FinishParallelOperation(size_t vertexes, const std::vector<Node*>& garbage, ForkBudget<Executor> budget) {
+        ClearLookupCache();
+        if (tree_root_ != nullptr) {
+            tree_root_->SetParent(nullptr);
+        }
+        FreeNodes(garbage.data(), garbage.size(), budget);
+        set_size_ = vertexes - garbage.size();
+    }
+
     // Deletes all vertexes of the tree with the given root, complexity O(n)
-    void Delete(Node* vertex) {
+    AA_SET_CONSTEXPR void Delete(Node* vertex) {
         if (vertex != nullptr) {
             Delete(vertex->left_son);
             Delete(vertex->right_son);
-            delete vertex;
+            FreeNode(vertex);
         }
     }
 
     Node* tree_root_ = nullptr;
     size_t set_size_ = EMPTY_SIZE;
+    size_t tombstones_ = 0;
+    MembershipFilter* membership_filter_ = nullptr;
+    LookupCache* lookup_cache_ = nullptr;
+    Arena* arena_ = nullptr;
+    NodeAllocator node_allocator_;
+    std::vector<Node*> retained_nodes_;
+    size_t retained_nodes_limit_ = 0;
 };
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Set.h"
+#include "WorkStealingPool.h"
+
+#include <type_traits>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<execution>)
+#include <execution>
+#if defined(__cpp_lib_execution)
+#define AA_SET_HAS_EXECUTION 1
+#endif
+#endif
+#endif
+
+// Standard execution policies in place of executors in the parallel operations of Set, like
+// Set(std::execution::par, first, last) or erase_if(std::execution::par, predicate): std::execution::seq runs the
+// operation in the calling thread, the other policies run it on the default pool, since the operations fork on
+// their own and only need to know whether they may do it. Kept out of Set.h, because <execution> of some standard
+// libraries requires linking with their parallel backend: libstdc++ uses TBB when it's installed, so programs that
+// include this header are linked with -ltbb there, or with TBB::tbb in CMake
+#if defined(AA_SET_HAS_EXECUTION)
+template<typename Policy>
+struct ExecutorOf<Policy, typename std::enable_if<
+    std::is_same<typename std::remove_const<Policy>::type, std::execution::sequenced_policy>::value>::type> {
+    using Type = SequentialExecutor;
+
+    static Type& Get(Policy&) {
+        static SequentialExecutor executor;
+        return executor;
+    }
+};
+
+template<typename Policy>
+struct ExecutorOf<Policy, typename std::enable_if<
+    std::is_execution_policy<typename std::remove_const<Policy>::type>::value &&
+    !std::is_same<typename std::remove_const<Policy>::type, std::execution::sequenced_policy>::value>::type> {
+    using Type = WorkStealingPool;
+
+    static Type& Get(Policy&) {
+        return WorkStealingPool::Default();
+    }
+};
+#endif
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#if __cplusplus >= 202002L && defined(__cpp_impl_three_way_comparison) && defined(__has_include)
+#if __has_include(<compare>) && __has_include(<concepts>)
+#include <compare>
+#include <concepts>
+#define AA_SET_HAS_THREE_WAY_COMPARISON 1
+#endif
+#endif
+
+#if __cplusplus >= 202002L && defined(__has_include)
+#if __has_include(<span>)
+#include <span>
+#define AA_SET_HAS_SPAN 1
+#endif
+#endif
+
+// Set is usable in constant evaluation when the compiler supports constexpr new and delete
+#if __cplusplus >= 202002L && defined(__cpp_constexpr_dynamic_alloc)
+#define AA_SET_CONSTEXPR constexpr
+#else
+#define AA_SET_CONSTEXPR
+#endif
+
+// Returns negative number if lhs is less than rhs, positive if it's greater, or zero if they are equivalent,
+// uses single operator<=> call when the value type provides it, otherwise two calls of operator<,
+// complexity O(1) comparisons
+template<typename ValueType>
+AA_SET_CONSTEXPR int ThreeWayCompare(const ValueType& lhs, const ValueType& rhs) {
+#if defined(AA_SET_HAS_THREE_WAY_COMPARISON)
+    if constexpr (std::three_way_comparable<ValueType>) {
+        auto order = lhs <=> rhs;
+        if (order < 0) {
+            return -1;
+        }
+        return order > 0 ? 1 : 0;
+    } else
+#endif
+    {
+        if (lhs < rhs) {
+            return -1;
+        }
+        return rhs < lhs ? 1 : 0;
+    }
+}
+
+// Fixed-width prefix of the value that is cached in the vertexes of the set, for value types where comparison of
+// prefixes resolves most comparisons of values. Prefixes must be ordered like values: if prefix of a is less than
+// prefix of b, then a is less than b, and equal prefixes tell nothing
+template<typename ValueType>
+struct KeyPrefix {
+    static constexpr bool ENABLED = false;
+};
+
+template<>
+struct KeyPrefix<std::string> {
+    static constexpr bool ENABLED = true;
+
+    using Type = uint64_t;
+
+    // Returns first 8 characters of the string packed in big-endian order and padded with zeros, so the prefixes
+    // compare as unsigned characters, like std::string does, complexity O(1)
+    static AA_SET_CONSTEXPR Type Make(const std::string& value) {
+        Type ans = 0;
+        for (size_t i = 0; i < sizeof(Type); ++i) {
+            ans <<= 8;
+            if (i < value.size()) {
+                ans |= static_cast<unsigned char>(value[i]);
+            }
+        }
+        return ans;
+    }
+};
+
+// Storage of the key prefix in the vertex of the set, empty if prefixes are disabled for the value type
+template<typename ValueType, bool HasPrefix = KeyPrefix<ValueType>::ENABLED>
+struct NodeKeyPrefix {
+    AA_SET_CONSTEXPR void SetPrefix(const ValueType&) {}
+};
+
+template<typename ValueType>
+struct NodeKeyPrefix<ValueType, true> {
+    typename KeyPrefix<ValueType>::Type prefix;
+
+    AA_SET_CONSTEXPR void SetPrefix(const ValueType& value) {
+        prefix = KeyPrefix<ValueType>::Make(value);
+    }
+};
+
+// Link of the vertex to its parent, empty if the set doesn't keep parent links, then Parent() is always nullptr
+template<typename NodeType, bool HasParentLink>
+struct NodeParentLink {
+    NodeType* parent = nullptr;
+
+    AA_SET_CONSTEXPR NodeType* Parent() const {
+        return parent;
+    }
+
+    AA_SET_CONSTEXPR void SetParent(NodeType* vertex) {
+        parent = vertex;
+    }
+};
+
+template<typename NodeType>
+struct NodeParentLink<NodeType, false> {
+    AA_SET_CONSTEXPR NodeType* Parent() const {
+        return nullptr;
+    }
+
+    AA_SET_CONSTEXPR void SetParent(NodeType*) {}
+};
+
+// Searched value with its key prefix computed once per descent
+template<typename ValueType, bool HasPrefix = KeyPrefix<ValueType>::ENABLED>
+struct SearchKey {
+    AA_SET_CONSTEXPR explicit SearchKey(const ValueType& value) : value(value) {}
+
+    // Returns negative number if the prefix of the key is less than the prefix of the vertex, positive if it's
+    // greater, or zero if the prefixes don't resolve the comparison, complexity O(1)
+    AA_SET_CONSTEXPR int ComparePrefix(const NodeKeyPrefix<ValueType, HasPrefix>&) const {
+        return 0;
+    }
+
+    const ValueType& value;
+};
+
+template<typename ValueType>
+struct SearchKey<ValueType, true> {
+    AA_SET_CONSTEXPR explicit SearchKey(const ValueType& value)
+        : value(value)
+        , prefix(KeyPrefix<ValueType>::Make(value))
+    {}
+
+    // Returns negative number if the prefix of the key is less than the prefix of the vertex, positive if it's
+    // greater, or zero if the prefixes don't resolve the comparison, complexity O(1)
+    AA_SET_CONSTEXPR int ComparePrefix(const NodeKeyPrefix<ValueType, true>& vertex) const {
+        if (prefix < vertex.prefix) {
+            return -1;
+        }
+        return vertex.prefix < prefix ? 1 : 0;
+    }
+
+    const ValueType& value;
+    typename KeyPrefix<ValueType>::Type prefix;
+};
+
+// Tells whether one allocator object may allocate and deallocate memory from several threads at once, then parallel
+// operations of Set create and free vertexes in parallel, otherwise they do it in the calling thread
+template<typename Allocator>
+struct IsConcurrentAllocator : std::false_type {};
+
+template<typename ValueType>
+struct IsConcurrentAllocator<std::allocator<ValueType>> : std::true_type {};
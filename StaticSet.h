@@ -0,0 +1,428 @@
+#pragma once
+
+#include "SetTraits.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+
+// Ordered set of at most N elements with the same interface as Set, implemented with using AA-tree, whose vertexes
+// are stored in the internal array and linked by indexes, so the set never allocates memory and can be used where
+// allocation is forbidden. Value type must be default constructible, erased values stay in the free vertexes until
+// they are reused
+template<typename ValueType, size_t N>
+class StaticSet {
+  private:
+    using Index = uint32_t;
+
+    static constexpr Index NIL = UINT32_MAX;
+
+    static_assert(N < NIL, "Capacity of the set must be less than 2^32 - 1");
+
+    // Vertex of the AA-tree, free vertexes are linked with right_son
+    struct Node : NodeKeyPrefix<ValueType> {
+        ValueType value{};
+        Index level = BASIC_LEVEL;
+        Index parent = NIL;
+        Index left_son = NIL;
+        Index right_son = NIL;
+
+        static constexpr Index BASIC_LEVEL = 1;
+    };
+
+    using Key = SearchKey<ValueType>;
+
+  public:
+    StaticSet() {
+        for (size_t i = 0; i < N; ++i) {
+            nodes_[i].right_son = i + 1 < N ? static_cast<Index>(i + 1) : NIL;
+        }
+        free_list_ = N > 0 ? 0 : NIL;
+    }
+
+    // Inserts elements while there is free space, complexity O(k log n)
+    template<typename FirstIterator, typename LastIterator>
+    StaticSet(FirstIterator begin, LastIterator end) : StaticSet() {
+        while (begin != end) {
+            insert(*begin);
+            ++begin;
+        }
+    }
+
+    // Inserts elements while there is free space, complexity O(k log n)
+    StaticSet(std::initializer_list<ValueType> elements) : StaticSet() {
+        for (const auto& value: elements) {
+            insert(value);
+        }
+    }
+
+    // Iterator of the element of the set
+    class iterator {
+      public:
+        iterator(const StaticSet* iterator_owner, Index current_vertex)
+            : iterator_owner(iterator_owner)
+            , current_vertex(current_vertex)
+        {}
+
+        iterator() : iterator_owner(nullptr), current_vertex(NIL) {}
+
+        const ValueType& operator*() const {
+            return iterator_owner->nodes_[current_vertex].value;
+        }
+
+        const ValueType* operator->() const {
+            return &iterator_owner->nodes_[current_vertex].value;
+        }
+
+        // Finds iterator of the next element by value, complexity O(log n), average complexity O(1)
+        iterator& operator++() {
+            current_vertex = iterator_owner->Next(current_vertex);
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator ans = *this;
+            ++*this;
+            return ans;
+        }
+
+        // Finds iterator of the previous element by value, complexity O(log n), average complexity O(1)
+        iterator& operator--() {
+            if (current_vertex == NIL) {
+                current_vertex = iterator_owner->Rightmost(iterator_owner->tree_root_);
+                return *this;
+            }
+            current_vertex = iterator_owner->Prev(current_vertex);
+            return *this;
+        }
+
+        iterator operator--(int) {
+            iterator ans = *this;
+            --*this;
+            return ans;
+        }
+
+        bool operator!=(const iterator& it) const {
+            return it.current_vertex != current_vertex || it.iterator_owner != iterator_owner;
+        }
+
+        bool operator==(const iterator& it) const {
+            return !(*this != it);
+        }
+
+      private:
+        const StaticSet* iterator_owner;
+        Index current_vertex;
+    };
+
+    // If given value isn't in the set - inserts it, returns iterator of element with given value and boolean that
+    // equals true if value was inserted, if the set is full and doesn't contain the value - returns end() and false,
+    // complexity O(log n)
+    std::pair<iterator, bool> insert(const ValueType& value) {
+        Key key(value);
+        Index found = Find(tree_root_, key);
+        if (found != NIL) {
+            return {iterator(this, found), false};
+        }
+        if (free_list_ == NIL) {
+            return {end(), false};
+        }
+        Index inserted_vertex = NIL;
+        tree_root_ = Insert(tree_root_, key, inserted_vertex);
+        nodes_[tree_root_].parent = NIL;
+        return {iterator(this, inserted_vertex), true};
+    }
+
+    // If given value is in the set - erase it, returns amount of erased elements, complexity O(log n)
+    size_t erase(const ValueType& value) {
+        size_t previous_size = set_size_;
+        tree_root_ = Erase(tree_root_, Key(value));
+        if (tree_root_ != NIL) {
+            nodes_[tree_root_].parent = NIL;
+        }
+        return previous_size - set_size_;
+    }
+
+    // If given value is in the set - returns iterator of the element with this value,
+    // else - returns end(), complexity O(log n)
+    iterator find(const ValueType& value) const {
+        return iterator(this, Find(tree_root_, Key(value)));
+    }
+
+    // Returns iterator of the element with the smallest value not less, then given,
+    // or end() if this element doesn't exist, complexity O(log n)
+    iterator lower_bound(const ValueType& value) const {
+        return iterator(this, LowerBound(tree_root_, Key(value)));
+    }
+
+    // Returns iterator of the first element of the set, or end() if set is empty(), complexity O(log n)
+    iterator begin() const {
+        return iterator(this, Leftmost(tree_root_));
+    }
+
+    // Returns iterator of the end of the set, complexity O(1)
+    iterator end() const {
+        return iterator(this, NIL);
+    }
+
+    // Returns amount of elements the set contains, complexity O(1)
+    size_t size() const {
+        return set_size_;
+    }
+
+    // Returns true if set is empty, or false if it isn't, complexity O(1)
+    bool empty() const {
+        return size() == EMPTY_SIZE;
+    }
+
+    // Returns maximal amount of elements the set can contain, complexity O(1)
+    static constexpr size_t capacity() {
+        return N;
+    }
+
+    // Returns true if no more elements can be inserted, complexity O(1)
+    bool full() const {
+        return free_list_ == NIL;
+    }
+
+    static constexpr size_t EMPTY_SIZE = 0;
+
+  private:
+    // Returns negative number if the key is less than the value of the vertex, positive if it's greater, or zero if
+    // they are equal, complexity O(1)
+    int Compare(const Key& key, Index vertex) const {
+        int prefix_order = key.ComparePrefix(nodes_[vertex]);
+        if (prefix_order != 0) {
+            return prefix_order;
+        }
+        return ThreeWayCompare(key.value, nodes_[vertex].value);
+    }
+
+    // Takes vertex from the free list and stores the given value in it, complexity O(1)
+    Index AllocateNode(const ValueType& value) {
+        Index vertex = free_list_;
+        free_list_ = nodes_[vertex].right_son;
+        Node& node = nodes_[vertex];
+        node.value = value;
+        node.SetPrefix(value);
+        node.level = Node::BASIC_LEVEL;
+        node.parent = NIL;
+        node.left_son = NIL;
+        node.right_son = NIL;
+        return vertex;
+    }
+
+    // Returns vertex to the free list, complexity O(1)
+    void FreeNode(Index vertex) {
+        nodes_[vertex].right_son = free_list_;
+        free_list_ = vertex;
+    }
+
+    // Returns level of the vertex, or zero for NIL, complexity O(1)
+    Index Level(Index vertex) const {
+        return vertex == NIL ? 0 : nodes_[vertex].level;
+    }
+
+    // Sets parent of the vertex if it isn't NIL, complexity O(1)
+    void SetParent(Index vertex, Index parent) {
+        if (vertex != NIL) {
+            nodes_[vertex].parent = parent;
+        }
+    }
+
+    // Rotates the given vertex to balance level, according to the left son, complexity O(1)
+    Index Skew(Index vertex) {
+        Index s = nodes_[vertex].left_son;
+        if (s == NIL || nodes_[s].level != nodes_[vertex].level) {
+            return vertex;
+        }
+        nodes_[vertex].left_son = nodes_[s].right_son;
+        SetParent(nodes_[s].right_son, vertex);
+        nodes_[s].right_son = vertex;
+        nodes_[s].parent = nodes_[vertex].parent;
+        nodes_[vertex].parent = s;
+        return s;
+    }
+
+    // Rotates the given vertex to balance level, according to the right son, complexity O(1)
+    Index Split(Index vertex) {
+        Index s = nodes_[vertex].right_son;
+        if (s == NIL || nodes_[s].right_son == NIL || nodes_[vertex].level != nodes_[nodes_[s].right_son].level) {
+            return vertex;
+        }
+        nodes_[vertex].right_son = nodes_[s].left_son;
+        SetParent(nodes_[s].left_son, vertex);
+        nodes_[s].left_son = vertex;
+        nodes_[s].parent = nodes_[vertex].parent;
+        nodes_[vertex].parent = s;
+        ++nodes_[s].level;
+        return s;
+    }
+
+    // Insert value it the AA-tree, there must be a free vertex and no vertex with this value, returns root of the
+    // modified tree and vertex with the given value, complexity O(log n)
+    Index Insert(Index t, const Key& key, Index& inserted_vertex) {
+        if (t == NIL) {
+            inserted_vertex = AllocateNode(key.value);
+            ++set_size_;
+            return inserted_vertex;
+        }
+        if (Compare(key, t) < 0) {
+            Index son = Insert(nodes_[t].left_son, key, inserted_vertex);
+            nodes_[t].left_son = son;
+            nodes_[son].parent = t;
+        } else {
+            Index son = Insert(nodes_[t].right_son, key, inserted_vertex);
+            nodes_[t].right_son = son;
+            nodes_[son].parent = t;
+        }
+        t = Skew(t);
+        t = Split(t);
+        return t;
+    }
+
+    // Balances level of given vertex, complexity O(1)
+    void DecreaseLevel(Index vertex) {
+        Node& node = nodes_[vertex];
+        Index expected_level = std::min(Level(node.left_son), Level(node.right_son)) + 1;
+        if (node.level > expected_level) {
+            node.level = expected_level;
+            if (node.right_son != NIL && nodes_[node.right_son].level > expected_level) {
+                nodes_[node.right_son].level = expected_level;
+            }
+        }
+    }
+
+    // Returns the leftmost vertex of the subtree, or NIL if it's empty, complexity O(log n)
+    Index Leftmost(Index vertex) const {
+        while (vertex != NIL && nodes_[vertex].left_son != NIL) {
+            vertex = nodes_[vertex].left_son;
+        }
+        return vertex;
+    }
+
+    // Returns the rightmost vertex of the subtree, or NIL if it's empty, complexity O(log n)
+    Index Rightmost(Index vertex) const {
+        while (vertex != NIL && nodes_[vertex].right_son != NIL) {
+            vertex = nodes_[vertex].right_son;
+        }
+        return vertex;
+    }
+
+    // Erases value from the AA-tree if it contains it, returns root of the modified tree, complexity O(log n)
+    Index Erase(Index vertex, const Key& key) {
+        if (vertex == NIL) {
+            return NIL;
+        }
+        int order = Compare(key, vertex);
+        if (order < 0) {
+            nodes_[vertex].left_son = Erase(nodes_[vertex].left_son, key);
+            SetParent(nodes_[vertex].left_son, vertex);
+        } else if (order > 0) {
+            nodes_[vertex].right_son = Erase(nodes_[vertex].right_son, key);
+            SetParent(nodes_[vertex].right_son, vertex);
+        } else {
+            if (nodes_[vertex].left_son == NIL && nodes_[vertex].right_son == NIL) {
+                FreeNode(vertex);
+                --set_size_;
+                return NIL;
+            }
+            if (nodes_[vertex].left_son == NIL) {
+                Index s = Leftmost(nodes_[vertex].right_son);
+                AssignValue(vertex, s);
+                nodes_[vertex].right_son = Erase(nodes_[vertex].right_son, Key(nodes_[vertex].value));
+                SetParent(nodes_[vertex].right_son, vertex);
+            } else {
+                Index s = Rightmost(nodes_[vertex].left_son);
+                AssignValue(vertex, s);
+                nodes_[vertex].left_son = Erase(nodes_[vertex].left_son, Key(nodes_[vertex].value));
+                SetParent(nodes_[vertex].left_son, vertex);
+            }
+        }
+        DecreaseLevel(vertex);
+        vertex = Skew(vertex);
+        Index right = nodes_[vertex].right_son;
+        if (right != NIL) {
+            right = Skew(right);
+            nodes_[vertex].right_son = right;
+            if (nodes_[right].right_son != NIL) {
+                nodes_[right].right_son = Skew(nodes_[right].right_son);
+            }
+        }
+        vertex = Split(vertex);
+        if (nodes_[vertex].right_son != NIL) {
+            nodes_[vertex].right_son = Split(nodes_[vertex].right_son);
+        }
+        return vertex;
+    }
+
+    // Copies value of the source vertex to the given vertex, complexity O(1)
+    void AssignValue(Index vertex, Index source) {
+        nodes_[vertex].value = nodes_[source].value;
+        static_cast<NodeKeyPrefix<ValueType>&>(nodes_[vertex]) = nodes_[source];
+    }
+
+    // Returns vertex with the first value that is greater than the value of the given vertex, complexity O(log n)
+    Index Next(Index vertex) const {
+        if (nodes_[vertex].right_son != NIL) {
+            return Leftmost(nodes_[vertex].right_son);
+        }
+        while (nodes_[vertex].parent != NIL && nodes_[nodes_[vertex].parent].left_son != vertex) {
+            vertex = nodes_[vertex].parent;
+        }
+        return nodes_[vertex].parent;
+    }
+
+    // Returns vertex with the first value that is less than the value of the given vertex, complexity O(log n)
+    Index Prev(Index vertex) const {
+        if (nodes_[vertex].left_son != NIL) {
+            return Rightmost(nodes_[vertex].left_son);
+        }
+        while (nodes_[vertex].parent != NIL && nodes_[nodes_[vertex].parent].right_son != vertex) {
+            vertex = nodes_[vertex].parent;
+        }
+        return nodes_[vertex].parent;
+    }
+
+    // Returns vertex with the given value if tree with the given root contains it, or NIL if it isn't,
+    // complexity O(log n)
+    Index Find(Index vertex, const Key& key) const {
+        while (vertex != NIL) {
+            int order = Compare(key, vertex);
+            if (order < 0) {
+                vertex = nodes_[vertex].left_son;
+            } else if (order > 0) {
+                vertex = nodes_[vertex].right_son;
+            } else {
+                return vertex;
+            }
+        }
+        return NIL;
+    }
+
+    // Returns vertex in the tree with the given root with the first value that is not less than the given value,
+    // or NIL if given tree doesn't contain it, complexity O(log n)
+    Index LowerBound(Index vertex, const Key& key) const {
+        Index ans = NIL;
+        while (vertex != NIL) {
+            int order = Compare(key, vertex);
+            if (order < 0) {
+                ans = vertex;
+                vertex = nodes_[vertex].left_son;
+            } else if (order > 0) {
+                vertex = nodes_[vertex].right_son;
+            } else {
+                return vertex;
+            }
+        }
+        return ans;
+    }
+
+    std::array<Node, N> nodes_;
+    Index tree_root_ = NIL;
+    Index free_list_ = NIL;
+    size_t set_size_ = EMPTY_SIZE;
+};
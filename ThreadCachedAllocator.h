@@ -0,0 +1,174 @@
+#pragma once
+
+#include "SetTraits.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Global depot of free blocks of the given size shared by all threads: blocks move between the depot and the
+// thread caches in batches, so the lock of the depot is taken once per batch. Blocks are carved out of slabs that
+// are never returned to the system, the depot itself is never destroyed, so blocks may be freed at any point of
+// the program exit
+template<size_t BlockSize, size_t Alignment>
+class NodeDepot {
+  public:
+    static NodeDepot& Instance() {
+        static NodeDepot* depot = new NodeDepot();
+        return *depot;
+    }
+
+    // Moves batch of free blocks to the given cache, complexity O(b)
+    void TakeBatch(std::vector<void*>& cache) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (batches_.empty()) {
+            char* slab = static_cast<char*>(::operator new(BlockSize * BATCH_SIZE));
+            for (size_t i = 0; i < BATCH_SIZE; ++i) {
+                cache.push_back(slab + i * BlockSize);
+            }
+            return;
+        }
+        cache.insert(cache.end(), batches_.back().begin(), batches_.back().end());
+        batches_.pop_back();
+    }
+
+    // Moves the last BATCH_SIZE blocks of the given cache to the depot, complexity O(b)
+    void PutBatch(std::vector<void*>& cache) {
+        std::vector<void*> batch(cache.end() - BATCH_SIZE, cache.end());
+        cache.resize(cache.size() - BATCH_SIZE);
+        std::lock_guard<std::mutex> lock(mutex_);
+        batches_.push_back(std::move(batch));
+    }
+
+    // Moves all blocks of the given cache to the depot, complexity O(k)
+    void PutAll(std::vector<void*>& cache) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (!cache.empty()) {
+            size_t batch_size = std::min(cache.size(), size_t(BATCH_SIZE));
+            batches_.emplace_back(cache.end() - batch_size, cache.end());
+            cache.resize(cache.size() - batch_size);
+        }
+    }
+
+    static constexpr size_t BATCH_SIZE = 64;
+
+    static_assert(Alignment <= alignof(std::max_align_t), "Slabs are aligned as std::max_align_t");
+
+  private:
+    NodeDepot() = default;
+
+    std::mutex mutex_;
+    std::vector<std::vector<void*>> batches_;
+};
+
+// Free blocks of the given size cached by the current thread, holds at most 2 * BATCH_SIZE of them and returns the
+// rest to the depot, returns everything when the thread exits
+template<size_t BlockSize, size_t Alignment>
+class NodeThreadCache {
+  public:
+    using Depot = NodeDepot<BlockSize, Alignment>;
+
+    // Returns free block, refilling the cache from the depot if it's empty, complexity O(1), amortized O(1) for the
+    // refills
+    static void* Allocate() {
+        if (is_destroyed_) {
+            std::vector<void*> batch;
+            Depot::Instance().TakeBatch(batch);
+            void* block = batch.back();
+            batch.pop_back();
+            Depot::Instance().PutAll(batch);
+            return block;
+        }
+        std::vector<void*>& blocks = Local().blocks_;
+        if (blocks.empty()) {
+            Depot::Instance().TakeBatch(blocks);
+        }
+        void* block = blocks.back();
+        blocks.pop_back();
+        return block;
+    }
+
+    // Puts block to the cache, returning a batch to the depot if the cache is full, complexity O(1), amortized O(1)
+    // for the returns
+    static void Deallocate(void* block) {
+        if (is_destroyed_) {
+            std::vector<void*> batch(1, block);
+            Depot::Instance().PutAll(batch);
+            return;
+        }
+        std::vector<void*>& blocks = Local().blocks_;
+        blocks.push_back(block);
+        if (blocks.size() > 2 * Depot::BATCH_SIZE) {
+            Depot::Instance().PutBatch(blocks);
+        }
+    }
+
+    ~NodeThreadCache() {
+        Depot::Instance().PutAll(blocks_);
+        is_destroyed_ = true;
+    }
+
+  private:
+    static NodeThreadCache& Local() {
+        static thread_local NodeThreadCache cache;
+        return cache;
+    }
+
+    std::vector<void*> blocks_;
+
+    // Set when the cache of the thread is destroyed, blocks freed after that go directly to the depot
+    static thread_local bool is_destroyed_;
+};
+
+template<size_t BlockSize, size_t Alignment>
+thread_local bool NodeThreadCache<BlockSize, Alignment>::is_destroyed_ = false;
+
+// Stateless allocator of single objects from the thread-local caches of blocks of their size, for containers that
+// are created and destroyed concurrently in many threads, like Set<ValueType, ThreadCachedAllocator<ValueType>>.
+// Allocations of several objects go to operator new
+template<typename ValueType>
+class ThreadCachedAllocator {
+  public:
+    using value_type = ValueType;
+    using is_always_equal = std::true_type;
+
+    ThreadCachedAllocator() = default;
+
+    template<typename OtherType>
+    ThreadCachedAllocator(const ThreadCachedAllocator<OtherType>&) {}
+
+    ValueType* allocate(size_t count) {
+        if (count != 1) {
+            return static_cast<ValueType*>(::operator new(count * sizeof(ValueType)));
+        }
+        return static_cast<ValueType*>(Cache::Allocate());
+    }
+
+    void deallocate(ValueType* memory, size_t count) {
+        if (count != 1) {
+            ::operator delete(memory);
+            return;
+        }
+        Cache::Deallocate(memory);
+    }
+
+    template<typename OtherType>
+    bool operator==(const ThreadCachedAllocator<OtherType>&) const {
+        return true;
+    }
+
+    template<typename OtherType>
+    bool operator!=(const ThreadCachedAllocator<OtherType>&) const {
+        return false;
+    }
+
+  private:
+    using Cache = NodeThreadCache<sizeof(ValueType), alignof(ValueType)>;
+};
+
+template<typename ValueType>
+struct IsConcurrentAllocator<ThreadCachedAllocator<ValueType>> : std::true_type {};
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Executors run the parallel operations of Set, which take them by reference and use the default pool below when
+// they are omitted. An executor is any class with two methods: Invoke(left, right), which runs both functions,
+// possibly in parallel, returns once both have finished and rethrows their exceptions, and thread_count(), which
+// tells how many threads may run the functions, so operations fork into enough tasks to keep them busy. Invoke
+// may be nested and may be called from several threads at once. SetExecution.h lets standard execution policies
+// be passed in place of executors
+
+// Pool of threads for fork-join parallelism: Invoke(left, right) offers the right function to other threads and
+// runs the left one in the calling thread. Every thread of the pool has its own deque of offered tasks, it takes
+// the newest ones from it and steals the oldest ones, which are the largest in divide-and-conquer algorithms, from
+// the others when it runs out of work. The calling thread counts as one of the threads, it helps to run tasks while
+// it waits for the stolen ones, so Invoke may be nested and may be called from any thread
+class WorkStealingPool {
+  public:
+    // Creates pool of the given amount of threads including the calling one, pool of one thread runs everything
+    // sequentially
+    explicit WorkStealingPool(size_t thread_count = std::max<unsigned>(std::thread::hardware_concurrency(), 1))
+        : queues_(std::max<size_t>(thread_count, 1))
+    {
+        for (size_t i = 1; i < queues_.size(); ++i) {
+            workers_.emplace_back([this, i] {
+                Work(i);
+            });
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            is_stopped_ = true;
+        }
+        wake_up_.notify_all();
+        for (std::thread& worker: workers_) {
+            worker.join();
+        }
+    }
+
+    // Runs both functions, the right one possibly in another thread, and returns once both have finished.
+    // Rethrows the exception of the left function, or of the right one if only it has thrown
+    template<typename Left, typename Right>
+    void Invoke(Left&& left, Right&& right) {
+        if (workers_.empty()) {
+            left();
+            right();
+            return;
+        }
+        BoundTask<Right> task(right);
+        size_t queue = CurrentQueue();
+        Push(queue, &task);
+        std::exception_ptr error;
+        try {
+            left();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        if (Remove(queue, &task)) {
+            if (error == nullptr) {
+                right();
+            }
+        } else {
+            WaitFor(queue, task);
+        }
+        if (error == nullptr) {
+            error = task.error;
+        }
+        if (error != nullptr) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Returns amount of threads including the calling one, complexity O(1)
+    size_t thread_count() const {
+        return queues_.size();
+    }
+
+    // Returns the pool of all hardware threads shared by the library, complexity O(1)
+    static WorkStealingPool& Default() {
+        static WorkStealingPool pool;
+        return pool;
+    }
+
+  private:
+    // Function offered to other threads, lives on the stack of the thread that offered it until it's done
+    struct Task {
+        explicit Task(void (*run)(Task*)) : run(run) {}
+
+        void (*run)(Task*);
+        std::exception_ptr error;
+        std::atomic<bool> is_done{false};
+    };
+
+    template<typename Function>
+    struct BoundTask : Task {
+        explicit BoundTask(Function& function) : Task(&BoundTask::Run), function(function) {}
+
+        static void Run(Task* task) {
+            static_cast<BoundTask*>(task)->function();
+        }
+
+        Function& function;
+    };
+
+    // Deque of the offered tasks of one thread, threads that don't belong to the pool share the first one
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task*> tasks;
+    };
+
+    // Returns index of the queue of the calling thread, complexity O(1)
+    size_t CurrentQueue() const {
+        return CurrentWorker().pool == this ? CurrentWorker().queue : 0;
+    }
+
+    struct Worker {
+        const WorkStealingPool* pool = nullptr;
+        size_t queue = 0;
+    };
+
+    static Worker& CurrentWorker() {
+        static thread_local Worker worker;
+        return worker;
+    }
+
+    // Adds task to the given queue and wakes up a sleeping thread, the task is counted before the queue is unlocked,
+    // so thieves can't take it and decrement the counter first, complexity O(1)
+    void Push(size_t queue, Task* task) {
+        {
+            std::lock_guard<std::mutex> lock(queues_[queue].mutex);
+            queues_[queue].tasks.push_back(task);
+            std::lock_guard<std::mutex> sleep_lock(sleep_mutex_);
+            ++queued_tasks_;
+        }
+        wake_up_.notify_one();
+    }
+
+    // Takes the given task back from the queue, returns false if it was stolen, complexity O(1) for the tasks at
+    // the back of the queue
+    bool Remove(size_t queue, Task* task) {
+        std::lock_guard<std::mutex> lock(queues_[queue].mutex);
+        std::deque<Task*>& tasks = queues_[queue].tasks;
+        auto position = std::find(tasks.rbegin(), tasks.rend(), task);
+        if (position == tasks.rend()) {
+            return false;
+        }
+        tasks.erase(std::next(position).base());
+        std::lock_guard<std::mutex> sleep_lock(sleep_mutex_);
+        --queued_tasks_;
+        return true;
+    }
+
+    // Takes the newest task of the given queue, or the oldest task of another one, returns nullptr if there are
+    // none, complexity O(threads)
+    Task* Take(size_t queue) {
+        for (size_t i = 0; i < queues_.size(); ++i) {
+            Queue& victim = queues_[(queue + i) % queues_.size()];
+            Task* task = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (victim.tasks.empty()) {
+                    continue;
+                }
+                if (i == 0) {
+                    task = victim.tasks.back();
+                    victim.tasks.pop_back();
+                } else {
+                    task = victim.tasks.front();
+                    victim.tasks.pop_front();
+                }
+            }
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            --queued_tasks_;
+            return task;
+        }
+        return nullptr;
+    }
+
+    static void Execute(Task* task) {
+        try {
+            task->run(task);
+        } catch (...) {
+            task->error = std::current_exception();
+        }
+        task->is_done.store(true, std::memory_order_release);
+    }
+
+    // Runs other tasks until the given stolen one is done, complexity O(1) per task
+    void WaitFor(size_t queue, Task& task) {
+        while (!task.is_done.load(std::memory_order_acquire)) {
+            Task* other = Take(queue);
+            if (other != nullptr) {
+                Execute(other);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Runs tasks of the pool in the thread of the given queue, sleeps while there are none
+    void Work(size_t queue) {
+        CurrentWorker().pool = this;
+        CurrentWorker().queue = queue;
+        while (true) {
+            Task* task = Take(queue);
+            if (task != nullptr) {
+                Execute(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            wake_up_.wait(lock, [this] {
+                return is_stopped_ || queued_tasks_ != 0;
+            });
+            if (is_stopped_) {
+                return;
+            }
+        }
+    }
+
+    std::vector<Queue> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_up_;
+    size_t queued_tasks_ = 0;
+    bool is_stopped_ = false;
+};
+
+// Executor that runs everything in the calling thread
+class SequentialExecutor {
+  public:
+    template<typename Left, typename Right>
+    void Invoke(Left&& left, Right&& right) {
+        left();
+        right();
+    }
+
+    size_t thread_count() const {
+        return 1;
+    }
+};
+
+// Executor that runs the operations given the executor object, which is the object itself for executors.
+// Specializations map other objects, like the execution policies of SetExecution.h, to executors
+template<typename Executor, typename = void>
+struct ExecutorOf {
+    using Type = Executor;
+
+    static Type& Get(Executor& executor) {
+        return executor;
+    }
+};